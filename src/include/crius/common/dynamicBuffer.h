@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QOpenGLFunctions_3_3_Core>
+
+/**
+ * @brief gl buffer object with geometrically growing storage
+ *
+ * the buffer object keeps its name for its whole lifetime, so vertex array
+ * and texture buffer bindings referring to it stay valid when its content is
+ * replaced or grows. storage is only respecified when the content outgrows
+ * it, and orphaned when the whole content is rewritten.
+ *
+ * all methods except the getters must be called with the context of create
+ * being current. the buffer object is not released by the destructor.
+ */
+class DynamicBuffer
+{
+public:
+
+    void create(QOpenGLFunctions_3_3_Core *gl);
+
+    void destroy();
+
+    bool isCreated() const noexcept;
+
+    GLuint getHandle() const noexcept;
+
+    /** @brief number of bytes of valid content */
+    size_t getSize() const noexcept;
+
+    size_t getCapacity() const noexcept;
+
+    /** @brief grow storage to at least byteSize bytes, keeping the content */
+    void reserve(size_t byteSize);
+
+    /**
+     * @brief replace the whole content
+     *
+     * data is written through mapped ranges of bounded size, so that the
+     * driver never needs a staging copy of all the data. blocks that cannot
+     * be mapped are uploaded with glBufferSubData, and so is the whole data
+     * again if unmapping reports a corrupted data store
+     */
+    void setData(const void *data, size_t byteSize);
+
+    /**
+     * @brief overwrite [offset, offset + byteSize) of the content, which may
+     *  extend the content
+     */
+    void updateRange(size_t offset, const void *data, size_t byteSize);
+
+    /** @brief returns byte offset of the appended data */
+    size_t append(const void *data, size_t byteSize);
+
+private:
+
+    void respecify(size_t capacity);
+
+    QOpenGLFunctions_3_3_Core *gl_ = nullptr;
+
+    GLuint handle_   = 0;
+    size_t size_     = 0;
+    size_t capacity_ = 0;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <crius/common.h>
+
+/**
+ * @brief side planes of a camera's view volume, used for culling
+ *
+ * near and far planes are not included, since renderers clip depth with
+ * their own distances
+ */
+class Frustum
+{
+public:
+
+    /**
+     * @param dir normalized view direction
+     * @param fovY full vertical field of view, in radians
+     */
+    static Frustum perspective(
+        const Vec3 &eye, const Vec3 &dir, float fovY, float wOverH) noexcept;
+
+    /**
+     * @param dir normalized view direction
+     * @param height full height of the view volume
+     */
+    static Frustum orthographic(
+        const Vec3 &eye, const Vec3 &dir, float height, float wOverH) noexcept;
+
+    /**
+     * @brief is the box, expanded by margin, outside of any side plane
+     */
+    bool isOutside(const AABB &box, float margin = 0) const noexcept;
+
+private:
+
+    // p is inside a plane iff dot(normal, p) + offset >= 0
+    struct Plane
+    {
+        Vec3  normal;
+        float offset;
+    };
+
+    Plane planes_[4];
+};
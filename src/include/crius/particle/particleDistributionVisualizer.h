@@ -11,8 +11,9 @@ class ParticleDistributionVisualizer : public QWidget
 public:
 
     ParticleDistributionVisualizer(
-        QWidget           *parent,
-        const std::string &particleXMLFilename);
+        QWidget                        *parent,
+        const std::string              &particleXMLFilename,
+        RC<agz::thread::thread_group_t> threadGroup);
 
 private:
 
@@ -20,10 +21,10 @@ private:
     VelocityColorMapper *colorMapper_;
 
     float minVel_, maxVel_;
-    std::vector<ParticleRenderer::Particle> particles_;
-    std::vector<float> colorBy_;
 
     ParticleRenderer *renderer_;
     QPushButton *useDefaultCamera_;
     QCheckBox *perspectiveCamera_;
+    QCheckBox *impostors_;
+    QCheckBox *density_;
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <agz/utility/thread.h>
+
 #include <crius/common.h>
 
 class ParticleLoader
@@ -12,7 +14,17 @@ public:
         float colorBy;
     };
 
-    void loadFromXML(const std::string &filename);
+    /**
+     * @brief load particles from xml file
+     *
+     * sections in the file are decoded in parallel, and particles are
+     * stored in the order of their sections. decoded particles are written
+     * into a binary cache next to the file, which is used instead of the xml
+     * on later loads as long as the file is unchanged.
+     */
+    void loadFromXML(
+        const std::string           &filename,
+        agz::thread::thread_group_t &threadGroup);
 
     const std::vector<Particle> &getAllParticles() const noexcept;
 
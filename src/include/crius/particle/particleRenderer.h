@@ -6,6 +6,7 @@
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLWidget>
 
+#include <crius/common/dynamicBuffer.h>
 #include <crius/particle/particleLoader.h>
 
 class ParticleRenderer
@@ -13,15 +14,26 @@ class ParticleRenderer
 {
 public:
 
+    /**
+     * @brief value is a scalar in [0, 1] mapped to the particle color
+     */
     struct Particle
     {
-        agz::math::vec3f   offset;
-        agz::math::color3f color;
+        agz::math::vec3f offset;
+        float            value;
     };
 
+    /**
+     * @brief particles are spatially sorted into chunks with given thread
+     *  group
+     *
+     * colorMap holds colors of uniformly spaced values in [0, 1]
+     */
     ParticleRenderer(
-        QWidget              *parent,
-        std::vector<Particle> particles);
+        QWidget                        *parent,
+        std::vector<Particle>           particles,
+        std::vector<agz::math::color3f> colorMap,
+        agz::thread::thread_group_t    &threadGroup);
 
     ~ParticleRenderer();
 
@@ -31,6 +43,22 @@ public:
 
     void setRenderedCount(int renderedCount);
 
+    /**
+     * @brief draw particles as ray-cast sphere impostors instead of meshes
+     */
+    void useImpostors(bool impostors);
+
+    /**
+     * @brief accumulate particles additively and show their density instead
+     *  of the nearest surfaces
+     */
+    void useDensityMode(bool density);
+
+    /**
+     * @brief higher intensity makes pixels opaque at lower densities
+     */
+    void setDensityIntensity(float intensity);
+
     void setNearClipDistance(float distance);
 
     void setFarClipDistance(float distance);
@@ -55,7 +83,21 @@ protected:
 
 private:
 
-    void setParticles(int renderedCount);
+    // sort particles along a morton curve and split them into chunks
+    void buildChunks(agz::thread::thread_group_t &threadGroup);
+
+    // aggregate chunks into a hierarchy of splat nodes
+    void buildSplats(agz::thread::thread_group_t &threadGroup);
+
+    void setParticles();
+
+    // (re)create the density target if the viewport size changes
+    void prepareDensityTarget(int width, int height);
+
+    void resolveDensity();
+
+    // point instance attributes to the instance data starting at given index
+    void bindInstanceData(int firstInstance);
 
     struct ParticleVertex
     {
@@ -63,7 +105,57 @@ private:
         agz::math::vec3f normal;
     };
 
-    std::vector<Particle> particles_;
+    // gpu instance data. offset is normalized to the bound of its chunk
+    struct QuantizedParticle
+    {
+        uint16_t offset[3];
+        uint16_t value;
+    };
+
+    // a sphere standing for all particles in a cell of a chunk
+    struct Splat
+    {
+        agz::math::vec3f offset;
+        float            value;
+        float            radius;
+    };
+
+    // a chunk is a range of spatially close particles, culled as a whole.
+    // particles in a chunk are shuffled so that any prefix of it is a random
+    // subset of the chunk. far chunks are drawn by splat nodes instead
+    struct ParticleChunk
+    {
+        AABB  bound;
+        int   first;
+        int   count;
+    };
+
+    // node of a binary hierarchy over chunks. leaf i stands for chunk i, and
+    // each parent merges two adjacent nodes along the morton curve. splats
+    // of a node aggregate everything in its chunk range
+    struct SplatNode
+    {
+        AABB bound;
+        int  firstChunk;
+        int  chunkCount;
+        int  children[2]; // -1 when absent. leaves have no children
+
+        int   splatFirst     = 0;
+        int   splatCount     = 0;
+        float splatCellSize  = 0;
+        float maxSplatRadius = 0; // over the whole subtree
+    };
+
+    std::vector<Particle>           particles_;
+    std::vector<QuantizedParticle>  quantizedParticles_;
+    std::vector<Splat>              splats_;
+    std::vector<ParticleChunk>      chunks_;
+    std::vector<SplatNode>          splatNodes_; // the root is the last one
+    std::vector<agz::math::color3f> colorMap_;
+
+    int lastVisibleChunkCount_ = 0;
+    int lastDrawnCount_        = 0;
+    int lastSplatNodeCount_    = 0;
 
     QTimer *wheelTimer_    = nullptr;
     bool isWheelScrolling_ = false;
@@ -88,12 +180,38 @@ private:
     float farClipDistance_ = 1;
 
     QOpenGLShaderProgram particleShader_;
+    QOpenGLShaderProgram impostorShader_;
+
+    bool useImpostors_ = false;
+
+    // radius of the bounding sphere of the particle mesh
+    float particleRadius_ = 0;
 
     int vertexCount_   = 0;
     int instanceCount_ = 0;
     int renderedCount_ = 0;
 
     QOpenGLBuffer            particleVertices_;
-    QOpenGLBuffer            particleInstanceData_;
+    DynamicBuffer            particleInstanceData_;
     QOpenGLVertexArrayObject particleVAO_;
+    QOpenGLVertexArrayObject impostorVAO_;
+
+    DynamicBuffer            splatData_;
+    QOpenGLVertexArrayObject splatVAO_;
+
+    DynamicBuffer chunkBoundBuffer_;
+    GLuint        chunkBoundTexture_ = 0;
+    GLuint        colorMapTexture_   = 0;
+
+    bool  densityMode_      = false;
+    float densityIntensity_ = 0.05f;
+
+    QOpenGLShaderProgram     densityShader_;
+    QOpenGLShaderProgram     densityResolveShader_;
+    QOpenGLVertexArrayObject densityResolveVAO_;
+
+    GLuint densityFramebuffer_  = 0;
+    GLuint densityTexture_      = 0;
+    int    densityTargetWidth_  = 0;
+    int    densityTargetHeight_ = 0;
 };
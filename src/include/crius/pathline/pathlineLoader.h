@@ -1,27 +1,32 @@
 #pragma once
 
-#include <crius/common.h>
+#include <agz/utility/thread.h>
+
+#include <crius/pathline/pathlineSet.h>
 
 class PathlineLoader
 {
 public:
 
-    struct Timepoint
-    {
-        float time;
-        Vec3 position;
-    };
-
-    struct Pathline
-    {
-        std::vector<Timepoint> points;
-    };
+    /**
+     * @brief load pathlines from xml file
+     *
+     * sections in the file are decoded in parallel, and timepoints are
+     * grouped by particle id and sorted by time with a parallel radix sort.
+     * grouped pathlines are written into a binary cache next to the file,
+     * which is used instead of the xml on later loads as long as the file is
+     * unchanged.
+     */
+    void loadFromXML(
+        const std::string           &filename,
+        agz::thread::thread_group_t &threadGroup);
 
-    void loadFromXML(const std::string &filename);
+    /** @brief pathlines ordered by particle id */
+    const PathlineSet &getAllPathlines() const noexcept;
 
-    const std::vector<Pathline> &getAllPathlines() const noexcept;
+    PathlineSet &getAllPathlines() noexcept;
 
 private:
 
-    std::vector<Pathline> allPathlines_;
+    PathlineSet allPathlines_;
 };
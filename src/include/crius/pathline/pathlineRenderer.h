@@ -1,11 +1,12 @@
 #pragma once
 
-#include <QOpenGLBuffer>
 #include <QOpenGLFunctions_3_3_Core>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLWidget>
+#include <QTimer>
 
+#include <crius/common/dynamicBuffer.h>
 #include <crius/pathline/pathlineLoader.h>
 
 class PathlineRenderer
@@ -13,23 +14,57 @@ class PathlineRenderer
 {
 public:
 
-    struct Pathline
-    {
-        std::vector<agz::math::vec3f> points;
-    };
-
+    /**
+     * @brief simplified levels of detail of the pathlines are built with
+     *  given thread group
+     */
     PathlineRenderer(
-        QWidget              *parent,
-        std::vector<Pathline> pathlines);
+        QWidget                     *parent,
+        PathlineSet                  pathlines,
+        agz::thread::thread_group_t &threadGroup);
 
     ~PathlineRenderer();
 
+    /**
+     * @brief append pathlines after existing ones
+     *
+     * appended pathlines are simplified for each level of detail with given
+     * thread group, and are uploaded without touching existing ones. if all
+     * pathlines were rendered, appended ones are rendered too.
+     */
+    void appendPathlines(
+        const PathlineSet           &pathlines,
+        agz::thread::thread_group_t &threadGroup);
+
+    /** @brief remove all pathlines, keeping the camera */
+    void clearPathlines();
+
+    /**
+     * @brief set the box framed by the default camera, which is otherwise
+     *  the bounding box of initial pathlines
+     */
+    void setBoundingBox(const AABB &bbox);
+
     void useDefaultCamera();
 
     void usePerspectiveCamera(bool perspective);
 
     void setRenderedCount(int renderedCount);
 
+    float getMinTime() const noexcept;
+
+    float getMaxTime() const noexcept;
+
+    /**
+     * @brief draw only the part of each pathline within
+     *  [currentTime - tailLength, currentTime]
+     */
+    void setAnimated(bool animated);
+
+    void setCurrentTime(float time);
+
+    void setTailLength(float length);
+
 protected:
 
     void initializeGL() override;
@@ -52,13 +87,42 @@ private:
 
     void setPathlines();
 
+    // pathline points are shared by adjacent segments of a line strip, and
+    // colors are looked up by pathline index from colorTexture_
     struct Vertex
     {
         agz::math::vec3f position;
-        agz::math::color3f color;
+        uint32_t         pathlineIndex;
+        float            time;
     };
 
-    std::vector<Pathline> pathlines_;
+    // a level of detail is the pathline set simplified with some tolerance.
+    // level 0 is the original pathline set
+    struct LevelOfDetail
+    {
+        float tolerance = 0;
+
+        // cleared after uploaded
+        PathlineSet pathlines;
+
+        // the ith rendered pathline is the strip of stripCounts[i] vertices
+        // starting at stripFirsts[i]
+        std::vector<GLint>   stripFirsts;
+        std::vector<GLsizei> stripCounts;
+    };
+
+    // world-space size of a pixel at the look-at point
+    float getPixelToWorldScale() const noexcept;
+
+    // select the coarsest level whose tolerance is at most a few pixels on
+    // the screen, allowing larger errors while interacting
+    int selectLevel(float pixelToWorldScale) const noexcept;
+
+    std::vector<LevelOfDetail> levels_;
+    int lastRenderedLevel_ = 0;
+
+    QTimer *wheelTimer_    = nullptr;
+    bool isWheelScrolling_ = false;
 
     int lastMiddlePressX_ = 0;
     int lastMiddlePressY_ = 0;
@@ -78,10 +142,19 @@ private:
 
     QOpenGLShaderProgram pathlineShader_;
 
-    int vertexCount_;
-    int vertexPerPathline_;
-    int renderedVertexCount_;
+    int pathlineCount_;
+    int renderedPathlineCount_;
 
-    QOpenGLBuffer            vertices_;
+    float minTime_     = 0;
+    float maxTime_     = 0;
+    bool  animated_    = false;
+    float currentTime_ = 0;
+    float tailLength_  = 0;
+
+    DynamicBuffer            vertices_;
     QOpenGLVertexArrayObject vao_;
+
+    // rgba8 color of each rendered pathline, as a buffer texture
+    DynamicBuffer colorBuffer_;
+    GLuint        colorTexture_ = 0;
 };
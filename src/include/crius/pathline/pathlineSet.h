@@ -0,0 +1,26 @@
+#pragma once
+
+#include <crius/common.h>
+
+/**
+ * @brief flat storage of a set of pathlines
+ *
+ * timepoints of pathline i are [offsets[i], offsets[i + 1]) of positions and
+ * times, sorted by time
+ */
+struct PathlineSet
+{
+    std::vector<Vec3>    positions;
+    std::vector<float>   times;
+    std::vector<int32_t> offsets = { 0 };
+
+    int getPathlineCount() const noexcept
+    {
+        return static_cast<int>(offsets.size()) - 1;
+    }
+
+    int getTimepointCount() const noexcept
+    {
+        return static_cast<int>(positions.size());
+    }
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <agz/utility/thread.h>
+
+#include <crius/pathline/pathlineSet.h>
+
+/**
+ * @brief simplify each pathline with the douglas-peucker algorithm
+ *
+ * a timepoint is dropped only if it is within given tolerance of the segment
+ * between the kept timepoints around it. the first and last timepoints of
+ * each pathline are always kept, so pathline indices are unchanged.
+ */
+PathlineSet simplifyPathlines(
+    const PathlineSet           &pathlines,
+    float                        tolerance,
+    agz::thread::thread_group_t &threadGroup);
@@ -2,22 +2,35 @@
 
 #include <QCheckBox>
 #include <QPushButton>
+#include <QTimer>
 
 #include <crius/pathline/pathlineRenderer.h>
+#include <crius/utility/doubleSlider.h>
 
 class PathlineVisualizer : public QWidget
 {
 public:
 
     PathlineVisualizer(
-        QWidget           *parent,
-        const std::string &particleXMLFilename);
+        QWidget                        *parent,
+        const std::string              &particleXMLFilename,
+        RC<agz::thread::thread_group_t> threadGroup);
 
 private:
 
+    // time between two playback frames, and time to play the whole range
+    static constexpr int PLAY_INTERVAL_MS = 33;
+    static constexpr int PLAY_DURATION_MS = 20000;
+
     int pathlineCount_;
 
     PathlineRenderer *renderer_;
     QPushButton *useDefaultCamera_;
     QCheckBox *perspectiveCamera_;
+
+    QCheckBox    *animate_;
+    QPushButton  *play_;
+    DoubleSlider *timeSlider_;
+    DoubleSlider *tailSlider_;
+    QTimer       *playTimer_;
 };
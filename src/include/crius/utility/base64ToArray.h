@@ -1,37 +1,62 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
-#include <vector>
 
 #include <QByteArray>
 
 #include <agz/utility/misc.h>
 
-// decode data is assumed to be of little endian
-inline std::vector<float> base64ToFloatArray(const char *base64)
+// number of bytes encoded by a base64 string, whitespaces are ignored
+inline size_t base64ByteCount(const char *base64)
 {
-    const auto byteArray = QByteArray::fromBase64(base64);
-    if(byteArray.size() % sizeof(float) != 0)
-        throw std::runtime_error("invalid float byte array size");
+    size_t charCount = 0;
+    for(const char *c = base64; *c; ++c)
+    {
+        if(*c != '=' && *c != ' ' && *c != '\t' && *c != '\n' && *c != '\r')
+            ++charCount;
+    }
+    return charCount * 3 / 4;
+}
 
-    std::vector<float> ret;
-    constexpr int BYTE_STEP = sizeof(float);
-    for(int i = 0; i < byteArray.size(); i += BYTE_STEP)
+// decode data is assumed to be of little endian
+template<typename T>
+void base64ToArray(const char *base64, T *output, size_t count)
+{
+    // wrap the text without copying since it may live in a large mapped file
+    const auto byteArray = QByteArray::fromBase64(
+        QByteArray::fromRawData(base64, static_cast<int>(std::strlen(base64))));
+    if(static_cast<size_t>(byteArray.size()) != count * sizeof(T))
+        throw std::runtime_error("invalid base64 byte array size");
+
+    std::memcpy(output, byteArray.data(), count * sizeof(T));
+    for(size_t i = 0; i < count; ++i)
     {
-        const char chs[4] = {
-            byteArray.at(i),
-            byteArray.at(i + 1),
-            byteArray.at(i + 2),
-            byteArray.at(i + 3)
-        };
-
-        float value;
-        std::memcpy(&value, chs, sizeof(float));
-
-        ret.push_back(
-            agz::misc::to_local_endian<
-            agz::misc::endian_type::little>(value));
+        output[i] = agz::misc::to_local_endian<
+            agz::misc::endian_type::little>(output[i]);
     }
+}
 
-    return ret;
+// number of floats encoded by a base64 string, whitespaces are ignored
+inline size_t base64FloatCount(const char *base64)
+{
+    return base64ByteCount(base64) / sizeof(float);
+}
+
+inline void base64ToFloatArray(const char *base64, float *output, size_t count)
+{
+    base64ToArray(base64, output, count);
+}
+
+// number of int32s encoded by a base64 string, whitespaces are ignored
+inline size_t base64Int32Count(const char *base64)
+{
+    return base64ByteCount(base64) / sizeof(int32_t);
+}
+
+inline void base64ToInt32Array(
+    const char *base64, int32_t *output, size_t count)
+{
+    base64ToArray(base64, output, count);
 }
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <crius/common.h>
+#include <crius/utility/mappedFile.h>
+
+/**
+ * @brief binary columnar cache of data decoded from a source file
+ *
+ * a cache file starts with a header recording the size and modification time
+ * of its source file, followed by a column table, a loader-defined metadata
+ * block and the column data. each column is aligned to 64 bytes so that it
+ * can be used in place from the mapped cache file.
+ */
+class ColumnCache
+{
+public:
+
+    struct Column
+    {
+        const void *data;
+        size_t      byteSize;
+    };
+
+    /**
+     * @brief write columns into the cache file of given source file
+     *
+     * format is a loader-defined tag distinguishing different cache layouts.
+     * returns false when the cache file cannot be written.
+     */
+    static bool write(
+        const std::string         &sourceFilename,
+        uint32_t                   format,
+        const void                *metadata,
+        size_t                     metadataSize,
+        const std::vector<Column> &columns);
+
+    /**
+     * @brief open the cache file of given source file
+     *
+     * returns nullptr when the cache file is missing, stale or of another
+     * format
+     */
+    static Box<ColumnCache> open(
+        const std::string &sourceFilename,
+        uint32_t           format,
+        size_t             metadataSize);
+
+    const void *getMetadata() const noexcept;
+
+    size_t getColumnCount() const noexcept;
+
+    /** @brief returns nullptr if column size is not a multiple of sizeof(T) */
+    template<typename T>
+    const T *getColumn(size_t index, size_t *elemCount) const noexcept;
+
+private:
+
+    struct ColumnEntry
+    {
+        uint64_t offset;
+        uint64_t byteSize;
+    };
+
+    ColumnCache() = default;
+
+    Box<MappedFile> file_;
+
+    const char *metadata_ = nullptr;
+    std::vector<ColumnEntry> columns_;
+};
+
+template<typename T>
+const T *ColumnCache::getColumn(size_t index, size_t *elemCount) const noexcept
+{
+    const auto &column = columns_[index];
+    if(column.byteSize % sizeof(T))
+        return nullptr;
+
+    *elemCount = static_cast<size_t>(column.byteSize / sizeof(T));
+    return reinterpret_cast<const T *>(file_->data() + column.offset);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+#include <QFile>
+
+/**
+ * @brief file mapped into memory with copy-on-write semantics
+ *
+ * modifications of the mapped content are private to the process and never
+ * written back. pages that are only read are shared with the os page cache,
+ * so reopening the same file does not read it from disk again.
+ */
+class MappedFile
+{
+public:
+
+    explicit MappedFile(const std::string &filename);
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    char *data() noexcept;
+
+    size_t size() const noexcept;
+
+private:
+
+    QFile file_;
+
+    uchar *data_;
+    qint64 size_;
+};
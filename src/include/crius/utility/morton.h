@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+#include <crius/common.h>
+
+// spread the lower 21 bits of v so that there are two zero bits between
+// each pair of adjacent bits
+inline uint64_t spreadMortonBits(uint64_t v) noexcept
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x001f00000000ffffull;
+    v = (v | v << 16) & 0x001f0000ff0000ffull;
+    v = (v | v << 8)  & 0x100f00f00f00f00full;
+    v = (v | v << 4)  & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2)  & 0x1249249249249249ull;
+    return v;
+}
+
+/**
+ * @brief 63-bit morton code of a point in given bounding box
+ *
+ * points close to each other in space tend to have close codes, so sorting
+ * by the code groups nearby points together
+ */
+inline uint64_t mortonCode(const Vec3 &p, const AABB &bound) noexcept
+{
+    constexpr float GRID = (1 << 21) - 1;
+
+    const Vec3 extent = bound.upper - bound.lower;
+    const auto toGrid = [&](float x, float lower, float ext)
+    {
+        const float t = ext > 0 ? (x - lower) / ext : 0.0f;
+        return static_cast<uint64_t>(agz::math::saturate(t) * GRID);
+    };
+
+    return spreadMortonBits(toGrid(p.x, bound.lower.x, extent.x))
+        | (spreadMortonBits(toGrid(p.y, bound.lower.y, extent.y)) << 1)
+        | (spreadMortonBits(toGrid(p.z, bound.lower.z, extent.z)) << 2);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <vector>
+
+#include <agz/utility/thread.h>
+
+/**
+ * @brief process [0, count) in blocks with given thread group
+ *
+ * func is called as func(threadIndex, blockBeg, blockEnd). blocks are handed
+ * out dynamically, and the first exception thrown by any worker is rethrown
+ * on the calling thread after all workers are finished.
+ */
+template<typename Func>
+void parallelForBlocks(
+    agz::thread::thread_group_t &threadGroup,
+    int                          threadCount,
+    size_t                       count,
+    size_t                       blockSize,
+    Func                       &&func)
+{
+    if(!count)
+        return;
+
+    blockSize = (std::max<size_t>)(blockSize, 1);
+    const size_t blockCount = (count + blockSize - 1) / blockSize;
+    if(blockCount < static_cast<size_t>(threadCount))
+        threadCount = static_cast<int>(blockCount);
+
+    std::atomic<size_t> globalBlock = 0;
+    std::vector<std::exception_ptr> exceptions(threadCount);
+
+    threadGroup.run(
+        threadCount, [&](int threadIndex)
+    {
+        try
+        {
+            for(;;)
+            {
+                const size_t block = globalBlock++;
+                if(block >= blockCount)
+                    return;
+
+                const size_t beg = block * blockSize;
+                const size_t end = (std::min)(beg + blockSize, count);
+                func(threadIndex, beg, end);
+            }
+        }
+        catch(...)
+        {
+            exceptions[threadIndex] = std::current_exception();
+            globalBlock = blockCount;
+        }
+    });
+
+    for(auto &e : exceptions)
+    {
+        if(e)
+            std::rethrow_exception(e);
+    }
+}
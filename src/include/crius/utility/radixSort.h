@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include <agz/utility/thread.h>
+
+/**
+ * @brief stable parallel lsd radix sort of (key, value) pairs by key
+ *
+ * each pass sorts 8 bits of the keys. passes in which all keys share the same
+ * digit are skipped, so keys with few significant bits are cheap to sort.
+ */
+template<typename Value>
+void parallelRadixSort(
+    std::vector<uint64_t>       &keys,
+    std::vector<Value>          &values,
+    agz::thread::thread_group_t &threadGroup,
+    int                          threadCount)
+{
+    assert(keys.size() == values.size());
+
+    const size_t n = keys.size();
+    if(n < 2)
+        return;
+
+    // each thread owns a fixed block of the array, which keeps scatter stable
+
+    constexpr size_t MIN_BLOCK_SIZE = 1 << 14;
+    threadCount = static_cast<int>((std::max<size_t>)(1, (std::min<size_t>)(
+        threadCount, (n + MIN_BLOCK_SIZE - 1) / MIN_BLOCK_SIZE)));
+    const size_t blockSize = (n + threadCount - 1) / threadCount;
+
+    const auto blockRange = [&](int threadIndex)
+    {
+        const size_t beg = (std::min)(n, threadIndex * blockSize);
+        const size_t end = (std::min)(n, beg + blockSize);
+        return std::make_pair(beg, end);
+    };
+
+    // bits that differ among keys
+
+    std::vector<uint64_t> threadDiffBits(threadCount, 0);
+    threadGroup.run(
+        threadCount, [&](int threadIndex)
+    {
+        const auto [beg, end] = blockRange(threadIndex);
+        uint64_t diff = 0;
+        for(size_t i = beg; i < end; ++i)
+            diff |= keys[i] ^ keys[0];
+        threadDiffBits[threadIndex] = diff;
+    });
+
+    uint64_t diffBits = 0;
+    for(auto d : threadDiffBits)
+        diffBits |= d;
+
+    std::vector<uint64_t> keyBuffer(n);
+    std::vector<Value>    valueBuffer(n);
+    std::vector<size_t>   offsets(threadCount * 256);
+
+    for(int shift = 0; shift < 64; shift += 8)
+    {
+        if(!((diffBits >> shift) & 0xff))
+            continue;
+
+        threadGroup.run(
+            threadCount, [&](int threadIndex)
+        {
+            const auto [beg, end] = blockRange(threadIndex);
+            size_t *histogram = &offsets[threadIndex * 256];
+            std::fill(histogram, histogram + 256, 0);
+            for(size_t i = beg; i < end; ++i)
+                ++histogram[(keys[i] >> shift) & 0xff];
+        });
+
+        // exclusive prefix sum in (digit, block) order
+
+        size_t sum = 0;
+        for(int digit = 0; digit < 256; ++digit)
+        {
+            for(int t = 0; t < threadCount; ++t)
+            {
+                const size_t count = offsets[t * 256 + digit];
+                offsets[t * 256 + digit] = sum;
+                sum += count;
+            }
+        }
+
+        threadGroup.run(
+            threadCount, [&](int threadIndex)
+        {
+            const auto [beg, end] = blockRange(threadIndex);
+            size_t *offset = &offsets[threadIndex * 256];
+            for(size_t i = beg; i < end; ++i)
+            {
+                const size_t dst = offset[(keys[i] >> shift) & 0xff]++;
+                keyBuffer[dst]   = keys[i];
+                valueBuffer[dst] = values[i];
+            }
+        });
+
+        keys.swap(keyBuffer);
+        values.swap(valueBuffer);
+    }
+}
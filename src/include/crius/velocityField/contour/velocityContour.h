@@ -91,6 +91,9 @@ private:
 
     void updateColorMapperVelRange();
 
+    // set color mapper range to values in the visible part of the slice
+    void fitColorMapperVelRangeToView();
+
     void render();
 
     int renderThreadCount_;
@@ -6,6 +6,13 @@
 #include <QVector3D>
 #include <QMatrix4x4>
 
+#include <functional>
+#include <vector>
+
+#include <agz/utility/thread.h>
+
+#include <crius/common/dynamicBuffer.h>
+#include <crius/velocityField/velocityGrid.h>
 #include <crius/velocityField/fluentVelocityField.h>
 #include <crius/velocityField/constantVelocityField.h>
 #include <crius/common/hsvColorMapper.h>
@@ -22,23 +29,26 @@ public:
 	{
 		RANDOMSAMPLE = 0,
 		UNIFORMSAMPLE = 1,
-	    HALTONSAMPLE = 2
+	    HALTONSAMPLE = 2,
+		IMPORTANCESAMPLE = 3
 	};
 
 	struct InstanceData
 	{
-		Vec3 color_;
-		Mat4 modelMatrix_;
+		Vec3 position_;
+		Vec3 velocity_;
 
 		InstanceData() {}
-		InstanceData(Vec3 color, Mat4 modelMatrix) 
-			: color_(color), modelMatrix_(modelMatrix)
+		InstanceData(Vec3 position, Vec3 velocity)
+			: position_(position), velocity_(velocity)
 		{
 
 		}
 	};
 
-	FieldRenderer(QWidget* parent, const VelocityField* velocityField, HSVColorMapper* colorMapper);
+	FieldRenderer(
+		QWidget* parent, const VelocityField* velocityField, HSVColorMapper* colorMapper,
+		RC<agz::thread::thread_group_t> threadGroup);
 	~FieldRenderer();
 
 	void setVelcotityField(VelocityField* velocityField);
@@ -75,27 +85,41 @@ private:
 	QVector3D getCameraPosition();
 
 	void samplePoints(const AABB& bbox, long sampleNum);
+
+	// evaluate candidates [0, candidateCount) in parallel until sampleNum of
+	// them are accepted. results are in candidate order
+	void collectSamples(
+		long candidateCount, long sampleNum,
+		const std::function<bool(const VelocityField&, long, Vec3&, Vec3&)>& tryCandidate);
 	void randomSamplePoints(const AABB& bbox, long sampleNum);
 	void uniformSamplePoints(const AABB& bbox, long sampleNum);
 	void haltonSamplePoints(const AABB& bbox, long sampleNum);
+
+	// places samples with a density following speed and velocity variation
+	// over the whole field, estimated on a coarse grid built on first use
+	void importanceSamplePoints(long sampleNum);
+	void buildImportanceGrid();
 	static float radicalInverseFunction(int a, int b);
 
-	void constructInstanceData(HSVColorMapper *colorMapper, Vec3 scale);
-	Mat4 getModelMatrix(Vec3 point, Vec3 velocity, Vec3 scale);
+	// sorts samples along a morton curve and groups them into chunks, which
+	// are culled as a whole when painting
+	void constructInstanceData();
 
 	float getArrowSize(AABB bbox1, AABB bbox2, long sampleNum);
 
-	void updateInstanceOfMatrix(Vec3 scale);
-	void updateInstanceofColor();
+	void updateColorMap();
 	void updataInstanceVBO();
 	void bindInstanceVBOForPaint();
+	void bindInstanceData(int firstInstance);
 
 	// shader members
 	QOpenGLShaderProgram* shaderProgram_;
-	unsigned int vao_, vbo_, instanceVBO_;
+	unsigned int vao_, vbo_, colorMapTexture_;
+	DynamicBuffer instanceBuffer_;
 
 	// arrow model
 	QVector<Vec3> arrowVertices_;
+	float arrowRadius_;
 	
 	// camera settings
 	QVector3D velocityFiledCenter_, lookAt_, eye_;
@@ -104,11 +128,28 @@ private:
 	float yaw_, pitch_, cameraDistance_, fov_;
 	
     // instancing
-	QVector<InstanceData> instanceDatas_;
+	std::vector<InstanceData> instanceDatas_;
 	QVector<Vec3> velPointsSamples_, velocitySamples_;
 	const VelocityField* velocityField_;
 	HSVColorMapper *colorMapper_;
+	RC<agz::thread::thread_group_t> threadGroup_;
+	int threadCount_;
+	std::vector<RC<VelocityField>> threadLocalVelocityField_;
 	AABB velocityFieldBBox_, arrowBBox_;
+	float minVelocity_, maxVelocity_;
+
+	// consecutive instances close to each other in space
+	struct ArrowChunk
+	{
+		AABB bound;
+		int first;
+		int count;
+	};
+	std::vector<ArrowChunk> arrowChunks_;
+
+	// importance sampling
+	RC<VelocityGrid> importanceGrid_;
+	std::vector<float> importanceCdf_;
 
 	// instancing settings
 	long sampleNum_;
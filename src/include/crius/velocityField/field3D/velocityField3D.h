@@ -13,7 +13,9 @@ class VelocityField3D : public QWidget
 
 public:
 
-	VelocityField3D(QWidget* parent, RC<const VelocityField> velocityField);
+	VelocityField3D(
+		QWidget* parent, RC<const VelocityField> velocityField,
+		RC<agz::thread::thread_group_t> threadGroup);
 
 private:
 
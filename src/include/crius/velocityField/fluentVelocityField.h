@@ -6,10 +6,14 @@
 #include <vtkSmartPointer.h>
 #include <vtkStaticCellLocator.h>
 
-#include <crius/velocityField/velocityField.h>
+#include <crius/velocityField/occupancyGrid.h>
+#include <crius/velocityField/velocityRangePyramid.h>
 
 /**
  * @brief velocity field loaded from cas file exported by Fluent
+ *
+ * value ranges of regions are answered by a brick pyramid, and occupancy by
+ * a voxel mask, both built at load.
  */
 class FluentVelocityField : public VelocityField
 {
@@ -25,6 +29,13 @@ public:
 
     AABB getBoundingBox() const noexcept override;
 
+    std::optional<Range> getVelocityRange(
+        const AABB &region, VelocityComponent component) const noexcept override;
+
+    Occupancy getOccupancy(const Vec3 &pos) const noexcept override;
+
+    Occupancy getOccupancy(const AABB &region) const noexcept override;
+
     RC<VelocityField> cloneForParallelAccess() const override;
 
 private:
@@ -45,5 +56,8 @@ private:
 
     vtkSmartPointer<vtkStaticCellLocator> cellLocator_;
 
+    RC<const VelocityRangePyramid> rangePyramid_;
+    RC<const OccupancyGrid>        occupancyGrid_;
+
     vtkDataSet *dataSet_;
 };
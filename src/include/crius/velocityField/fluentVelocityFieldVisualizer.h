@@ -23,6 +23,12 @@ private:
 
     void add3DWindow();
 
+    void addStreamlineWindow();
+
+    void addVolumeWindow();
+
+    void addIsosurfaceWindow();
+
     QString filename_;
 
     RC<agz::thread::thread_group_t> threadGroup_;
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+
+#include <agz/utility/thread.h>
+
+#include <crius/velocityField/velocityGrid.h>
+
+/**
+ * @brief extract isosurfaces of velocity magnitude from a velocity grid
+ *
+ * cubes between adjacent cell centers are grouped into bricks. the value
+ * range of each brick is computed once, and bricks whose range does not
+ * contain the iso value are skipped. the first visit of a brick builds an
+ * interval tree over the value ranges of its valid cubes, so that cubes
+ * whose range contains the iso value are enumerated without looking at
+ * any other cube.
+ *
+ * each cube is split into six tetrahedra, whose surfaces need no lookup
+ * table and are free of the ambiguous cases of marching cubes.
+ */
+class IsosurfaceExtractor
+{
+public:
+
+    struct Stats
+    {
+        int    brickCount        = 0;
+        int    visitedBrickCount = 0;
+        int    triangleCount     = 0;
+        double seconds           = 0;
+    };
+
+    IsosurfaceExtractor(
+        RC<const VelocityGrid>       grid,
+        agz::thread::thread_group_t &threadGroup);
+
+    const VelocityGrid &getGrid() const noexcept;
+
+    /** @brief minimum and maximum magnitude over valid cells */
+    float getMinValue() const noexcept;
+
+    float getMaxValue() const noexcept;
+
+    /**
+     * @brief extract the surface of given magnitude
+     *
+     * returns triangle vertices, three per triangle. the result is valid
+     * until the next call.
+     */
+    const std::vector<Vec3> &extract(
+        float                        isoValue,
+        agz::thread::thread_group_t &threadGroup,
+        Stats                       *stats = nullptr);
+
+private:
+
+    // a cube is identified by the index of its lower corner cell
+    struct ActiveCube
+    {
+        int   cell;
+        float minValue;
+        float maxValue;
+    };
+
+    // node of a centered interval tree. cubes whose range contains center
+    // are stored at [beg, end) of both cubesByMin, sorted by ascending min,
+    // and cubesByMax, sorted by descending max. cubes entirely below center
+    // go to the left subtree, and cubes entirely above it to the right
+    struct IntervalNode
+    {
+        float center;
+        int   left;
+        int   right;
+        int   beg;
+        int   end;
+    };
+
+    struct Brick
+    {
+        Vec3i lower, upper; // range of lower corner cells of cubes
+
+        float minValue;
+        float maxValue;
+
+        bool isIntervalTreeBuilt = false;
+        std::vector<IntervalNode> nodes; // nodes[0] is the root if any
+        std::vector<ActiveCube>   cubesByMin;
+        std::vector<ActiveCube>   cubesByMax;
+
+        std::vector<Vec3> vertices;
+    };
+
+    void buildIntervalTree(Brick &brick) const;
+
+    // returns index of the subtree root, or -1 when cubes is empty
+    static int buildIntervalNode(Brick &brick, std::vector<ActiveCube> cubes);
+
+    void polygonizeCube(
+        const ActiveCube &cube, float isoValue, std::vector<Vec3> &output) const;
+
+    void extractBrick(Brick &brick, float isoValue) const;
+
+    RC<const VelocityGrid> grid_;
+
+    // magnitude of each cell, NaN for invalid cells
+    std::vector<float> values_;
+
+    float minValue_ = 0;
+    float maxValue_ = 0;
+
+    std::vector<Brick> bricks_;
+    std::vector<Vec3>  vertices_;
+};
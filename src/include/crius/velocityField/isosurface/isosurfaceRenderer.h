@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLWidget>
+
+#include <crius/common.h>
+#include <crius/common/dynamicBuffer.h>
+
+/**
+ * @brief renderer of a triangle soup isosurface
+ *
+ * normals are derived per pixel from screen space derivatives of positions,
+ * so only positions are stored. both sides of the surface are lit by a
+ * headlight.
+ */
+class IsosurfaceRenderer
+    : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+{
+public:
+
+    IsosurfaceRenderer(QWidget *parent, const AABB &boundingBox);
+
+    ~IsosurfaceRenderer();
+
+    /** @brief replace the surface. vertices are given three per triangle */
+    void setSurface(const std::vector<Vec3> &vertices);
+
+    void setColor(const QColor &color);
+
+    void useDefaultCamera();
+
+protected:
+
+    void initializeGL() override;
+
+    void paintGL() override;
+
+    void mousePressEvent(QMouseEvent *event) override;
+
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+    void leaveEvent(QEvent *event) override;
+
+    void wheelEvent(QWheelEvent *event) override;
+
+private:
+
+    float getPixelToWorldScale() const noexcept;
+
+    AABB boundingBox_;
+    Vec3 color_ = Vec3(1);
+
+    // vertices waiting for upload
+    std::vector<Vec3> pendingVertices_;
+    bool isSurfaceDirty_ = false;
+
+    QOpenGLShaderProgram surfaceShader_;
+    GLuint        vao_ = 0;
+    DynamicBuffer vertexBuffer_;
+    int           vertexCount_ = 0;
+
+    int lastMiddlePressX_ = 0;
+    int lastMiddlePressY_ = 0;
+    bool middlePressed_   = false;
+
+    int lastRightPressX_ = 0;
+    int lastRightPressY_ = 0;
+    bool rightPressed_   = false;
+
+    float horiRad_  = 0;
+    float vertRad_  = 0;
+    float distance_ = 1;
+    Vec3 lookAt_;
+};
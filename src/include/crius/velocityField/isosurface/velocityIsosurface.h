@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QComboBox>
+#include <QLabel>
+
+#include <crius/common/hsvColorMapper.h>
+#include <crius/utility/doubleSlider.h>
+#include <crius/velocityField/isosurface/isosurfaceExtractor.h>
+#include <crius/velocityField/isosurface/isosurfaceRenderer.h>
+
+/**
+ * @brief isosurface of velocity magnitude of a given velocity field
+ *
+ * the surface is extracted again whenever the iso value is dragged, which
+ * only revisits bricks of the grid whose value range contains it.
+ */
+class VelocityIsosurface : public QWidget
+{
+public:
+
+    VelocityIsosurface(
+        QWidget                        *parent,
+        RC<const VelocityField>         velocityField,
+        RC<agz::thread::thread_group_t> threadGroup);
+
+private:
+
+    // resample the field with the selected resolution
+    void createExtractor();
+
+    void extractSurface();
+
+    void updateSurfaceColor();
+
+    RC<const VelocityField>         velocityField_;
+    RC<agz::thread::thread_group_t> threadGroup_;
+
+    RC<IsosurfaceExtractor> extractor_;
+
+    QComboBox    *resolution_;
+    DoubleSlider *isoValue_;
+    QLabel       *stats_;
+
+    HSVColorMapper     *colorMapper_;
+    ColorBar           *colorBar_;
+    IsosurfaceRenderer *renderer_;
+};
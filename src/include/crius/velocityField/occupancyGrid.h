@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <crius/velocityField/velocityField.h>
+
+/**
+ * @brief coarse voxel mask of where a velocity field is defined
+ *
+ * a voxel overlapped by no cell bounding box is Outside. other voxels are
+ * Inside when the field is defined at all their corners and center, and
+ * Boundary otherwise. since Inside is only tested at these points, a hole
+ * smaller than a voxel may be missed, and getVelocity may still fail in an
+ * Inside voxel.
+ */
+class OccupancyGrid
+{
+public:
+
+    OccupancyGrid(const AABB &bound, int maxResolution);
+
+    /** @brief add a cell of the field. must be called before classify */
+    void addCell(const AABB &cellBound) noexcept;
+
+    /** @brief classify voxels overlapped by cells into Inside or Boundary */
+    void classify(const std::function<bool(const Vec3 &)> &isDefined);
+
+    VelocityField::Occupancy getOccupancy(const Vec3 &pos) const noexcept;
+
+    VelocityField::Occupancy getOccupancy(const AABB &region) const noexcept;
+
+private:
+
+    int getVoxelIndex(int x, int y, int z) const noexcept;
+
+    // index of the voxel containing given coordinate along axis, clamped
+    int getAxisVoxel(int axis, float coord) const noexcept;
+
+    AABB  bound_;
+    Vec3i res_;
+    Vec3  voxelSize_;
+
+    std::vector<VelocityField::Occupancy> voxels_;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+
+#include <agz/utility/thread.h>
+
+#include <crius/pathline/pathlineSet.h>
+#include <crius/velocityField/velocityField.h>
+
+/**
+ * @brief integration settings of streamline tracing
+ *
+ * lengths are in world units. a streamline stops when it leaves the field,
+ * slows down below minSpeed, or reaches maxPointCount or maxLength in one
+ * direction.
+ */
+struct StreamlineTracingParams
+{
+    enum class Method
+    {
+        RK4,  // classic runge-kutta with steps of stepLength
+        RK45  // dormand-prince with adaptive steps
+    };
+
+    Method method = Method::RK45;
+
+    // length of rk4 steps, and of the first rk45 step
+    float stepLength = 0.01f;
+
+    // bounds of adaptive step lengths
+    float minStepLength = 1e-5f;
+    float maxStepLength = 0.1f;
+
+    // allowed local position error of an adaptive step
+    float tolerance = 1e-4f;
+
+    float minSpeed      = 1e-6f;
+    int   maxPointCount = 1000;
+    float maxLength     = 1;
+
+    // trace upstream as well, giving negative times to upstream points
+    bool bothDirections = true;
+};
+
+struct StreamlineTracingStats
+{
+    int     seedCount  = 0;
+    int64_t pointCount = 0;
+    double  seconds    = 0;
+
+    double getSeedsPerSecond() const noexcept
+    {
+        return seconds > 0 ? seedCount / seconds : 0.0;
+    }
+};
+
+/**
+ * @brief trace a streamline from each seed
+ *
+ * seeds are traced in parallel, each worker with its own copy of the field.
+ * streamline i starts from seeds[i], and its times are the integration time
+ * relative to the seed. a seed where the velocity is undefined gives a
+ * streamline of the seed point only. since offsets of the result are int32,
+ * streamlines after the first one crossing INT32_MAX points in total are
+ * left empty.
+ */
+PathlineSet traceStreamlines(
+    const VelocityField           &field,
+    const std::vector<Vec3>       &seeds,
+    const StreamlineTracingParams &params,
+    agz::thread::thread_group_t   &threadGroup,
+    StreamlineTracingStats        *stats = nullptr);
+
+/**
+ * @brief trace streamlines with given per-thread copies of a field
+ *
+ * the thread group runs one worker per field copy. this avoids cloning the
+ * field when tracing many small batches of seeds.
+ */
+PathlineSet traceStreamlines(
+    const std::vector<RC<VelocityField>> &threadFields,
+    const std::vector<Vec3>              &seeds,
+    const StreamlineTracingParams        &params,
+    agz::thread::thread_group_t          &threadGroup,
+    StreamlineTracingStats               *stats = nullptr);
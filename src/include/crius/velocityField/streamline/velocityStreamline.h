@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QSpinBox>
+
+#include <crius/pathline/pathlineRenderer.h>
+#include <crius/utility/doubleSlider.h>
+#include <crius/velocityField/streamline/streamlineTracer.h>
+
+/**
+ * @brief streamlines traced from seeds scattered over a velocity field, or
+ *  placed on a line or plane rake
+ *
+ * streamlines are traced by a background worker in batches, which are
+ * appended to the renderer as they complete. a change of seeds supersedes
+ * the running request at the next batch. traced streamlines are cached by
+ * seed position, so seeds which were traced before are not traced again.
+ */
+class VelocityStreamline : public QWidget
+{
+public:
+
+    VelocityStreamline(
+        QWidget                        *parent,
+        RC<const VelocityField>         velocityField,
+        RC<agz::thread::thread_group_t> threadGroup);
+
+    ~VelocityStreamline();
+
+private:
+
+    enum class SeederType
+    {
+        Volume, // halton points where the velocity is defined
+        Line,   // evenly spaced points on a line across the field
+        Plane   // grid points on a plane across the field
+    };
+
+    struct SeederSettings
+    {
+        SeederType type;
+
+        // a line rake is parallel to axis (axis + 1) % 3, and a plane rake
+        // is perpendicular to axis. both are at given relative position
+        // along axis
+        int   axis;
+        float position;
+
+        int seedCount;
+    };
+
+    struct TraceRequest
+    {
+        int                     generation;
+        SeederSettings          seeder;
+        StreamlineTracingParams params;
+        bool                    clearCache;
+    };
+
+    struct CachedStreamline
+    {
+        std::vector<Vec3>  positions;
+        std::vector<float> times;
+    };
+
+    SeederSettings getSeederSettings() const;
+
+    StreamlineTracingParams getTracingParams() const;
+
+    // supersede the running request by a new one with current settings
+    void requestTrace(bool clearCache);
+
+    // called on the gui thread when a batch of given request is traced
+    void onBatchTraced(
+        int generation, const PathlineSet &batch,
+        int tracedCount, int cachedCount, double seconds);
+
+    // worker thread methods
+
+    void runWorker();
+
+    void processRequest(const TraceRequest &request);
+
+    // returns early with no seeds when given request is superseded
+    std::vector<Vec3> generateSeeds(
+        int generation, const SeederSettings &seeder);
+
+    RC<const VelocityField>         velocityField_;
+    RC<agz::thread::thread_group_t> threadGroup_;
+
+    // positions are normalized like loaded pathlines before rendering
+    Vec3  normalizeOffset_;
+    float normalizeScale_;
+
+    PathlineRenderer *renderer_;
+
+    QComboBox    *seederType_;
+    QComboBox    *rakeAxis_;
+    DoubleSlider *rakePosition_;
+    QSpinBox     *seedCount_;
+    QComboBox    *method_;
+    QLabel       *stats_;
+
+    // statistics of the current request
+
+    int    shownTracedCount_ = 0;
+    int    shownCachedCount_ = 0;
+    double shownSeconds_     = 0;
+
+    // worker state. the thread group and field copies of the worker are
+    // only used by the worker thread
+
+    std::atomic<int> generation_ = 0;
+
+    std::mutex                  workerMutex_;
+    std::condition_variable     workerCondition_;
+    std::optional<TraceRequest> pendingRequest_;
+    bool                        stopWorker_ = false;
+
+    RC<agz::thread::thread_group_t> workerThreadGroup_;
+    std::vector<RC<VelocityField>>  workerThreadFields_;
+
+    std::unordered_map<uint64_t, CachedStreamline> cache_;
+    size_t cachedPointCount_ = 0;
+
+    std::thread worker_;
+};
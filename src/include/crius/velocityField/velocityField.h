@@ -19,6 +19,27 @@ public:
         All = 3
     };
 
+    /**
+     * @brief coarse classification of space by whether velocity is defined
+     *
+     * velocity is undefined everywhere in an Outside region. an Inside
+     * region is probably defined everywhere, but may still have holes
+     * missed by the classification, so getVelocity must be checked there as
+     * well. a Boundary region may contain both.
+     */
+    enum class Occupancy : uint8_t
+    {
+        Outside,
+        Inside,
+        Boundary
+    };
+
+    struct Range
+    {
+        float low;
+        float high;
+    };
+
     virtual ~VelocityField() = default;
 
     /**
@@ -37,6 +58,45 @@ public:
     /** @brief get a bounding box of non-zero region */
     virtual AABB getBoundingBox() const noexcept = 0;
 
+    /**
+     * @brief get a conservative range of velocity values in a region
+     *
+     * the returned range contains all values of given component in region,
+     * but may be wider. returns nullopt when velocity is known to be
+     * undefined in the whole region.
+     *
+     * the default implementation returns the range of the whole field.
+     */
+    virtual std::optional<Range> getVelocityRange(
+        const AABB &region, VelocityComponent component) const noexcept
+    {
+        const AABB bound = getBoundingBox();
+        for(int i = 0; i < 3; ++i)
+        {
+            if(region.upper[i] < bound.lower[i] || bound.upper[i] < region.lower[i])
+                return std::nullopt;
+        }
+        return Range{ getMinVelocity(component), getMaxVelocity(component) };
+    }
+
+    /**
+     * @brief get occupancy of the neighborhood of a position
+     *
+     * samplers can reject Outside positions without calling getVelocity,
+     * but must not accept Inside ones without it. the default
+     * implementation knows nothing and returns Boundary.
+     */
+    virtual Occupancy getOccupancy(const Vec3 &pos) const noexcept
+    {
+        return Occupancy::Boundary;
+    }
+
+    /** @brief get occupancy of a whole region */
+    virtual Occupancy getOccupancy(const AABB &region) const noexcept
+    {
+        return Occupancy::Boundary;
+    }
+
     /** @brief get a thread local copy */
     virtual RC<VelocityField> cloneForParallelAccess() const = 0;
 };
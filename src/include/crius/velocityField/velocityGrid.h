@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include <agz/utility/thread.h>
+
+#include <crius/velocityField/velocityField.h>
+
+/**
+ * @brief velocity field resampled at cell centers of a regular grid
+ *
+ * the grid covers the bounding box of the field. its longest axis has the
+ * given number of cells, and other axes have cells of about the same size.
+ * cells whose center has no defined velocity are marked invalid.
+ */
+class VelocityGrid
+{
+public:
+
+    VelocityGrid(
+        const VelocityField         &field,
+        int                          maxResolution,
+        agz::thread::thread_group_t &threadGroup);
+
+    const AABB &getBoundingBox() const noexcept;
+
+    const Vec3i &getResolution() const noexcept;
+
+    const Vec3 &getCellSize() const noexcept;
+
+    int getCellCount() const noexcept;
+
+    /** @brief cells are stored with x varying fastest */
+    int getCellIndex(int x, int y, int z) const noexcept;
+
+    Vec3 getCellCenter(int x, int y, int z) const noexcept;
+
+    bool isValid(int cellIndex) const noexcept;
+
+    /** @brief velocity of an invalid cell is zero */
+    const Vec3 &getVelocity(int cellIndex) const noexcept;
+
+    /** @brief maximum speed over valid cells */
+    float getMaxSpeed() const noexcept;
+
+private:
+
+    AABB  bound_;
+    Vec3i res_;
+    Vec3  cellSize_;
+
+    std::vector<Vec3>    velocities_;
+    std::vector<uint8_t> valid_;
+
+    float maxSpeed_ = 0;
+};
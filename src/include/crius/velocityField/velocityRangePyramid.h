@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include <crius/velocityField/velocityField.h>
+
+/**
+ * @brief hierarchy of regular bricks storing value ranges of a velocity field
+ *
+ * the finest level has the given number of bricks along the longest axis of
+ * the bounding box, and each coarser level merges 2x2x2 bricks of the finer
+ * one. every brick stores the range of each component and of the magnitude
+ * over all cells overlapping it.
+ *
+ * range queries take whole bricks inside the query region from the coarsest
+ * level possible, and only descend into bricks crossing its boundary.
+ */
+class VelocityRangePyramid
+{
+public:
+
+    VelocityRangePyramid(const AABB &bound, int maxResolution);
+
+    /** @brief add a cell of the field. must be called before build */
+    void addCell(const AABB &cellBound, const Vec3 &velocity) noexcept;
+
+    /** @brief build coarser levels from the finest one */
+    void build();
+
+    /** @brief see VelocityField::getVelocityRange */
+    std::optional<VelocityField::Range> query(
+        const AABB                        &region,
+        VelocityField::VelocityComponent   component) const noexcept;
+
+private:
+
+    // component ranges are indexed by VelocityComponent. a brick without
+    // any cell has low > high
+    struct Brick
+    {
+        float low[4];
+        float high[4];
+
+        bool isEmpty() const noexcept { return low[3] > high[3]; }
+    };
+
+    struct Level
+    {
+        Vec3i res;
+        Vec3  brickSize;
+        std::vector<Brick> bricks;
+
+        int getBrickIndex(int x, int y, int z) const noexcept
+        {
+            return x + res.x * (y + res.y * z);
+        }
+    };
+
+    void queryBrick(
+        int level, int x, int y, int z, const AABB &region, int component,
+        VelocityField::Range &range, bool &isRangeEmpty) const noexcept;
+
+    AABB bound_;
+    std::vector<Level> levels_;
+};
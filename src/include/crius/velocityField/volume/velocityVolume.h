@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QComboBox>
+
+#include <crius/common/hsvColorMapper.h>
+#include <crius/utility/doubleSlider.h>
+#include <crius/velocityField/volume/volumeRenderer.h>
+
+/**
+ * @brief volume rendering widget of a given velocity field
+ */
+class VelocityVolume : public QWidget
+{
+public:
+
+    VelocityVolume(
+        QWidget                        *parent,
+        RC<const VelocityField>         velocityField,
+        RC<agz::thread::thread_group_t> threadGroup);
+
+private:
+
+    // resample the field with the selected resolution
+    RC<const VelocityGrid> createGrid() const;
+
+    void updateColorMapperVelRange();
+
+    RC<const VelocityField>         velocityField_;
+    RC<agz::thread::thread_group_t> threadGroup_;
+
+    QComboBox    *resolution_;
+    QComboBox    *quantity_;
+    DoubleSlider *opacity_;
+
+    HSVColorMapper *colorMapper_;
+    ColorBar       *colorBar_;
+    VolumeRenderer *renderer_;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLWidget>
+
+#include <agz/utility/thread.h>
+
+#include <crius/common/velocityColorMapper.h>
+#include <crius/velocityField/velocityGrid.h>
+
+/**
+ * @brief direct volume rendering of a resampled velocity field
+ *
+ * the rendered quantity is stored in a 3d texture, which is ray marched
+ * front to back in a fragment shader. each texel holds the normalized
+ * quantity and whether the field is defined there.
+ */
+class VolumeRenderer
+    : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+{
+public:
+
+    enum class Quantity
+    {
+        Magnitude = 0,
+        X         = 1,
+        Y         = 2,
+        Z         = 3
+    };
+
+    /**
+     * @brief colors are looked up from given color mapper, with the value
+     *  range of the rendered quantity
+     */
+    VolumeRenderer(
+        QWidget                        *parent,
+        RC<const VelocityGrid>          grid,
+        VelocityColorMapper            *colorMapper,
+        RC<agz::thread::thread_group_t> threadGroup);
+
+    ~VolumeRenderer();
+
+    void setGrid(RC<const VelocityGrid> grid);
+
+    void setQuantity(Quantity quantity);
+
+    /** @brief extinction of the largest value over the box diagonal */
+    void setOpacity(float opacity);
+
+    /** @brief re-sample the color mapper */
+    void updateColorMap();
+
+    float getMinValue() const noexcept;
+
+    float getMaxValue() const noexcept;
+
+    void useDefaultCamera();
+
+protected:
+
+    void initializeGL() override;
+
+    void paintGL() override;
+
+    void mousePressEvent(QMouseEvent *event) override;
+
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+    void leaveEvent(QEvent *event) override;
+
+    void wheelEvent(QWheelEvent *event) override;
+
+private:
+
+    // compute the value range of current quantity
+    void updateValueRange();
+
+    // upload current quantity of the grid in slabs of z slices. GL context
+    // must be current
+    void uploadVolume();
+
+    float getPixelToWorldScale() const noexcept;
+
+    RC<const VelocityGrid>          grid_;
+    VelocityColorMapper            *colorMapper_;
+    RC<agz::thread::thread_group_t> threadGroup_;
+
+    Quantity quantity_ = Quantity::Magnitude;
+    float minValue_    = 0;
+    float maxValue_    = 1;
+    float opacity_     = 1;
+
+    bool isVolumeDirty_   = true;
+    bool isColorMapDirty_ = true;
+
+    QOpenGLShaderProgram volumeShader_;
+    GLuint vao_             = 0;
+    GLuint volumeTexture_   = 0;
+    GLuint colorMapTexture_ = 0;
+
+    int lastMiddlePressX_ = 0;
+    int lastMiddlePressY_ = 0;
+    bool middlePressed_   = false;
+
+    int lastRightPressX_ = 0;
+    int lastRightPressY_ = 0;
+    bool rightPressed_   = false;
+
+    float horiRad_  = 0;
+    float vertRad_  = 0;
+    float distance_ = 1;
+    Vec3 lookAt_;
+};
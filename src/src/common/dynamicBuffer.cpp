@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cstring>
+
+#include <crius/common/dynamicBuffer.h>
+
+namespace
+{
+
+    constexpr size_t UPLOAD_BLOCK_SIZE = 64 << 20;
+
+    // writes never go through GL_ARRAY_BUFFER or GL_TEXTURE_BUFFER, so they
+    // do not disturb bindings of the caller
+    constexpr GLenum WRITE_TARGET = GL_COPY_WRITE_BUFFER;
+
+} // namespace anonymous
+
+void DynamicBuffer::create(QOpenGLFunctions_3_3_Core *gl)
+{
+    destroy();
+
+    gl_ = gl;
+    gl_->glGenBuffers(1, &handle_);
+}
+
+void DynamicBuffer::destroy()
+{
+    if(handle_)
+        gl_->glDeleteBuffers(1, &handle_);
+
+    handle_   = 0;
+    size_     = 0;
+    capacity_ = 0;
+}
+
+bool DynamicBuffer::isCreated() const noexcept
+{
+    return handle_ != 0;
+}
+
+GLuint DynamicBuffer::getHandle() const noexcept
+{
+    return handle_;
+}
+
+size_t DynamicBuffer::getSize() const noexcept
+{
+    return size_;
+}
+
+size_t DynamicBuffer::getCapacity() const noexcept
+{
+    return capacity_;
+}
+
+void DynamicBuffer::reserve(size_t byteSize)
+{
+    if(byteSize <= capacity_)
+        return;
+
+    const size_t newCapacity = (std::max)(byteSize, capacity_ + capacity_ / 2);
+
+    if(!size_)
+    {
+        respecify(newCapacity);
+        return;
+    }
+
+    // respecifying storage drops the content, which is kept in a temporary
+    // buffer meanwhile
+
+    GLuint temp;
+    gl_->glGenBuffers(1, &temp);
+    gl_->glBindBuffer(GL_COPY_READ_BUFFER, temp);
+    gl_->glBufferData(
+        GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(size_),
+        nullptr, GL_STREAM_COPY);
+
+    gl_->glBindBuffer(WRITE_TARGET, handle_);
+    gl_->glCopyBufferSubData(
+        WRITE_TARGET, GL_COPY_READ_BUFFER, 0, 0,
+        static_cast<GLsizeiptr>(size_));
+
+    respecify(newCapacity);
+
+    gl_->glBindBuffer(WRITE_TARGET, handle_);
+    gl_->glCopyBufferSubData(
+        GL_COPY_READ_BUFFER, WRITE_TARGET, 0, 0,
+        static_cast<GLsizeiptr>(size_));
+    gl_->glBindBuffer(WRITE_TARGET, 0);
+
+    gl_->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    gl_->glDeleteBuffers(1, &temp);
+}
+
+void DynamicBuffer::setData(const void *data, size_t byteSize)
+{
+    // orphan the old storage even if it is large enough, so that pending
+    // draws reading it never stall the writes below
+
+    respecify(byteSize > capacity_ ?
+        (std::max)(byteSize, capacity_ + capacity_ / 2) : capacity_);
+    size_ = byteSize;
+
+    gl_->glBindBuffer(WRITE_TARGET, handle_);
+
+    const char *src = static_cast<const char *>(data);
+    for(size_t offset = 0; offset < byteSize; offset += UPLOAD_BLOCK_SIZE)
+    {
+        const size_t size = (std::min)(UPLOAD_BLOCK_SIZE, byteSize - offset);
+        void *dst = gl_->glMapBufferRange(
+            WRITE_TARGET,
+            static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT);
+        if(!dst)
+        {
+            // mapping may fail, e.g. when the address space runs short. the
+            // block is uploaded without mapping instead
+            gl_->glBufferSubData(
+                WRITE_TARGET,
+                static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size),
+                src + offset);
+            continue;
+        }
+
+        std::memcpy(dst, src + offset, size);
+        if(!gl_->glUnmapBuffer(WRITE_TARGET))
+        {
+            // the data store got corrupted while mapped, e.g. by a display
+            // mode change, which may lose blocks written before as well. the
+            // whole content is uploaded again without mapping
+            gl_->glBufferSubData(
+                WRITE_TARGET, 0, static_cast<GLsizeiptr>(byteSize), data);
+            break;
+        }
+    }
+
+    gl_->glBindBuffer(WRITE_TARGET, 0);
+}
+
+void DynamicBuffer::updateRange(
+    size_t offset, const void *data, size_t byteSize)
+{
+    if(!byteSize)
+        return;
+
+    reserve(offset + byteSize);
+
+    gl_->glBindBuffer(WRITE_TARGET, handle_);
+    gl_->glBufferSubData(
+        WRITE_TARGET, static_cast<GLintptr>(offset),
+        static_cast<GLsizeiptr>(byteSize), data);
+    gl_->glBindBuffer(WRITE_TARGET, 0);
+
+    size_ = (std::max)(size_, offset + byteSize);
+}
+
+size_t DynamicBuffer::append(const void *data, size_t byteSize)
+{
+    const size_t offset = size_;
+    updateRange(offset, data, byteSize);
+    return offset;
+}
+
+void DynamicBuffer::respecify(size_t capacity)
+{
+    gl_->glBindBuffer(WRITE_TARGET, handle_);
+    gl_->glBufferData(
+        WRITE_TARGET, static_cast<GLsizeiptr>(capacity),
+        nullptr, GL_DYNAMIC_DRAW);
+    gl_->glBindBuffer(WRITE_TARGET, 0);
+
+    capacity_ = capacity;
+}
@@ -0,0 +1,74 @@
+#include <cmath>
+
+#include <crius/common/frustum.h>
+
+namespace
+{
+
+    // camera space axes, matching the look-at matrix with +y as world up
+    void cameraAxes(const Vec3 &dir, Vec3 *ex, Vec3 *ey) noexcept
+    {
+        *ex = cross(dir, Vec3(0, 1, 0)).normalize();
+        *ey = cross(*ex, dir);
+    }
+
+} // namespace anonymous
+
+Frustum Frustum::perspective(
+    const Vec3 &eye, const Vec3 &dir, float fovY, float wOverH) noexcept
+{
+    Vec3 ex, ey;
+    cameraAxes(dir, &ex, &ey);
+
+    const float tanY = std::tan(0.5f * fovY);
+    const float tanX = tanY * wOverH;
+
+    // p - eye = x * ex + y * ey + z * dir is inside iff
+    // |x| <= z * tanX and |y| <= z * tanY
+
+    Frustum ret;
+    const Vec3 normals[4] = {
+        (tanX * dir - ex).normalize(),
+        (tanX * dir + ex).normalize(),
+        (tanY * dir - ey).normalize(),
+        (tanY * dir + ey).normalize()
+    };
+    for(int i = 0; i < 4; ++i)
+        ret.planes_[i] = { normals[i], -dot(normals[i], eye) };
+
+    return ret;
+}
+
+Frustum Frustum::orthographic(
+    const Vec3 &eye, const Vec3 &dir, float height, float wOverH) noexcept
+{
+    Vec3 ex, ey;
+    cameraAxes(dir, &ex, &ey);
+
+    const float halfH = 0.5f * height;
+    const float halfW = halfH * wOverH;
+
+    Frustum ret;
+    ret.planes_[0] = { -ex, halfW + dot(ex, eye) };
+    ret.planes_[1] = {  ex, halfW - dot(ex, eye) };
+    ret.planes_[2] = { -ey, halfH + dot(ey, eye) };
+    ret.planes_[3] = {  ey, halfH - dot(ey, eye) };
+
+    return ret;
+}
+
+bool Frustum::isOutside(const AABB &box, float margin) const noexcept
+{
+    for(auto &plane : planes_)
+    {
+        // corner of the box farthest along the plane normal
+        const Vec3 corner = {
+            plane.normal.x > 0 ? box.upper.x : box.lower.x,
+            plane.normal.y > 0 ? box.upper.y : box.lower.y,
+            plane.normal.z > 0 ? box.upper.z : box.lower.z
+        };
+        if(dot(plane.normal, corner) + plane.offset < -margin)
+            return true;
+    }
+    return false;
+}
@@ -62,7 +62,7 @@ void MainWindow::addParticleDistribution()
     try
     {
         auto vis = new ParticleDistributionVisualizer(
-            tabs_, filename.toStdString());
+            tabs_, filename.toStdString(), threadGroup_);
 
         tabs_->addTab(vis, QFileInfo(filename).fileName());
     }
@@ -82,7 +82,7 @@ void MainWindow::addPathlines()
     try
     {
         auto vis = new PathlineVisualizer(
-            tabs_, filename.toStdString());
+            tabs_, filename.toStdString(), threadGroup_);
 
         tabs_->addTab(vis, QFileInfo(filename).fileName());
     }
@@ -1,12 +1,22 @@
+#include <cmath>
+
 #include <QGridLayout>
 #include <QVBoxLayout>
 
 #include <crius/particle/particleDistributionVisualizer.h>
 #include <crius/utility/doubleSlider.h>
 
+namespace
+{
+
+    constexpr int COLOR_MAP_SIZE = 256;
+
+} // namespace anonymous
+
 ParticleDistributionVisualizer::ParticleDistributionVisualizer(
-    QWidget           *parent,
-    const std::string &particleXMLFilename)
+    QWidget                        *parent,
+    const std::string              &particleXMLFilename,
+    RC<agz::thread::thread_group_t> threadGroup)
     : QWidget(parent)
 {
     auto layout     = new QVBoxLayout(this);
@@ -21,46 +31,67 @@ ParticleDistributionVisualizer::ParticleDistributionVisualizer(
     layout->addWidget(upPanel);
     layout->addWidget(downPanel);
 
-    ParticleLoader loader;
-    loader.loadFromXML(particleXMLFilename);
-
     auto perspectiveCameraText = new QLabel("Perspective camera", downPanel);
+    auto impostorsText = new QLabel("   Sphere impostors", downPanel);
+    auto densityText = new QLabel("   Density mode", downPanel);
 
-    minVel_ = std::numeric_limits<float>::max(), maxVel_ = -minVel_;
-    for(auto &p : loader.getAllParticles())
+    // the loader is released before the renderer sorts and uploads
+    // particles, so at most two copies of them are alive at any time
+
+    std::vector<ParticleRenderer::Particle> particles;
     {
-        minVel_ = std::min(minVel_, p.colorBy);
-        maxVel_ = std::max(maxVel_, p.colorBy);
+        ParticleLoader loader;
+        loader.loadFromXML(particleXMLFilename, *threadGroup);
+
+        minVel_ = std::numeric_limits<float>::max(), maxVel_ = -minVel_;
+        for(auto &p : loader.getAllParticles())
+        {
+            minVel_ = std::min(minVel_, p.colorBy);
+            maxVel_ = std::max(maxVel_, p.colorBy);
+        }
+        maxVel_ = (std::max)(minVel_ + 0.01f, maxVel_);
+        colorMapper_ = new HSVColorMapper(downPanel);
+        colorMapper_->setVelocityRange(minVel_, maxVel_);
+        colorMapper_->hide();
+
+        const float rcpVelRange = 1 / (maxVel_ - minVel_);
+        particles.reserve(loader.getAllParticles().size());
+        std::transform(
+            loader.getAllParticles().begin(),
+            loader.getAllParticles().end(),
+            std::back_inserter(particles),
+            [&](const ParticleLoader::Particle &p)
+        {
+            ParticleRenderer::Particle ret;
+            ret.offset = p.position;
+            ret.value  = agz::math::saturate(
+                (p.colorBy - minVel_) * rcpVelRange);
+            return ret;
+        });
     }
-    maxVel_ = (std::max)(minVel_ + 0.01f, maxVel_);
-    colorMapper_ = new HSVColorMapper(downPanel);
-    colorMapper_->setVelocityRange(minVel_, maxVel_);
-    colorMapper_->hide();
+    const int particleCount = static_cast<int>(particles.size());
 
-    colorBar_ = new ColorBar(upPanel, colorMapper_);
-    colorBar_->setParams(minVel_, maxVel_);
-
-    std::transform(
-        loader.getAllParticles().begin(),
-        loader.getAllParticles().end(),
-        std::back_inserter(particles_),
-        [&](const ParticleLoader::Particle &p)
+    std::vector<agz::math::color3f> colorMap(COLOR_MAP_SIZE);
+    for(int i = 0; i < COLOR_MAP_SIZE; ++i)
     {
-        const QColor color = colorMapper_->getColor(p.colorBy);
-        colorBy_.push_back(p.colorBy);
-
-        ParticleRenderer::Particle ret;
-        ret.offset = p.position;
-        ret.color  = {
+        const float t = static_cast<float>(i) / (COLOR_MAP_SIZE - 1);
+        const QColor color = colorMapper_->getColor(
+            agz::math::lerp(minVel_, maxVel_, t));
+        colorMap[i] = {
             static_cast<float>(color.redF()),
             static_cast<float>(color.greenF()),
             static_cast<float>(color.blueF())
         };
-        return ret;
-    });
+    }
 
-    renderer_          = new ParticleRenderer(upPanel, particles_);
+    colorBar_ = new ColorBar(upPanel, colorMapper_);
+    colorBar_->setParams(minVel_, maxVel_);
+
+    renderer_          = new ParticleRenderer(
+        upPanel, std::move(particles), std::move(colorMap), *threadGroup);
     perspectiveCamera_ = new QCheckBox(downPanel);
+    impostors_         = new QCheckBox(downPanel);
+    density_           = new QCheckBox(downPanel);
     useDefaultCamera_  = new QPushButton("Use default camera", downPanel);
 
     auto renderCountText  = new QLabel(this);
@@ -72,9 +103,12 @@ ParticleDistributionVisualizer::ParticleDistributionVisualizer(
     auto clipFarDistanceText = new QLabel(this);
     auto clipFarDistanceInput = new DoubleSlider(downPanel);
 
+    auto densityIntensityText = new QLabel(this);
+    auto densityIntensityInput = new DoubleSlider(downPanel);
+
     renderCountText->setText("Number of rendered particles: ");
-    renderCountInput->setRange(1, static_cast<int>(particles_.size()));
-    renderCountInput->setValue(static_cast<int>(particles_.size()));
+    renderCountInput->setRange(1, particleCount);
+    renderCountInput->setValue(particleCount);
 
     clipNearDistanceText->setText("   Near clipping distance: ");
     clipNearDistanceInput->setRange(0, 1);
@@ -84,10 +118,24 @@ ParticleDistributionVisualizer::ParticleDistributionVisualizer(
     clipFarDistanceInput->setRange(0, 1);
     clipFarDistanceInput->setValue(1);
 
+    // intensity is edited in log10 scale
+    densityIntensityText->setText("   Density intensity (log10): ");
+    densityIntensityInput->setRange(-4, 0);
+    densityIntensityInput->setValue(std::log10(0.05));
+
     perspectiveCamera_->setChecked(false);
+    impostors_->setChecked(false);
+    density_->setChecked(false);
 
     perspectiveCameraText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     perspectiveCamera_->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    impostorsText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    impostors_->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    densityText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    density_->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    densityIntensityText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    densityIntensityInput->setSizePolicy(
+        QSizePolicy::Minimum, QSizePolicy::Fixed);
     renderCountText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     renderCountInput->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Fixed);
     clipNearDistanceText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
@@ -99,12 +147,18 @@ ParticleDistributionVisualizer::ParticleDistributionVisualizer(
     downLayout->addWidget(perspectiveCameraText, 0, 0, 1, 1);
     downLayout->addWidget(perspectiveCamera_,    0, 1, 1, 1);
     downLayout->addWidget(useDefaultCamera_,     0, 2, 1, 1);
+    downLayout->addWidget(impostorsText,         0, 3, 1, 1);
+    downLayout->addWidget(impostors_,            0, 4, 1, 1);
+    downLayout->addWidget(densityText,           1, 3, 1, 1);
+    downLayout->addWidget(density_,              1, 4, 1, 1);
     downLayout->addWidget(renderCountText,       1, 0, 1, 1);
     downLayout->addWidget(renderCountInput,      1, 1, 1, 2);
     downLayout->addWidget(clipNearDistanceText,  0, 5, 1, 1);
     downLayout->addWidget(clipNearDistanceInput, 0, 6, 1, 1);
     downLayout->addWidget(clipFarDistanceText,   1, 5, 1, 1);
     downLayout->addWidget(clipFarDistanceInput,  1, 6, 1, 1);
+    downLayout->addWidget(densityIntensityText,  2, 5, 1, 1);
+    downLayout->addWidget(densityIntensityInput, 2, 6, 1, 1);
 
     connect(perspectiveCamera_, &QCheckBox::stateChanged,
             [&](int)
@@ -112,6 +166,18 @@ ParticleDistributionVisualizer::ParticleDistributionVisualizer(
         renderer_->usePerspectiveCamera(perspectiveCamera_->isChecked());
     });
 
+    connect(impostors_, &QCheckBox::stateChanged,
+            [&](int)
+    {
+        renderer_->useImpostors(impostors_->isChecked());
+    });
+
+    connect(density_, &QCheckBox::stateChanged,
+            [&](int)
+    {
+        renderer_->useDensityMode(density_->isChecked());
+    });
+
     connect(useDefaultCamera_, &QPushButton::clicked,
             [&](bool)
     {
@@ -137,4 +203,11 @@ ParticleDistributionVisualizer::ParticleDistributionVisualizer(
         renderer_->setFarClipDistance(
             static_cast<float>(clipFarDistanceInput->getValue()));
     });
+
+    connect(densityIntensityInput, &DoubleSlider::changingValue,
+        [this, densityIntensityInput]
+    {
+        renderer_->setDensityIntensity(static_cast<float>(
+            std::pow(10.0, densityIntensityInput->getValue())));
+    });
 }
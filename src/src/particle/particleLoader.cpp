@@ -1,7 +1,13 @@
+#include <cstring>
+#include <iostream>
+
 #include <pugixml/pugixml.hpp>
 
 #include <crius/particle/particleLoader.h>
 #include <crius/utility/base64ToArray.h>
+#include <crius/utility/columnCache.h>
+#include <crius/utility/mappedFile.h>
+#include <crius/utility/parallelFor.h>
 
 namespace
 {
@@ -77,54 +83,243 @@ namespace
         ret.colorBy = findParticleComponentData(section, indices.colorBy);
         return ret;
     }
+
+    // cache columns: normalized x, y, z and colorBy, all of float32
+
+    constexpr uint32_t PARTICLE_CACHE_FORMAT = 0x50545231; // 'PTR1'
+
+    struct ParticleCacheMetadata
+    {
+        uint64_t particleCount;
+        float    offset[3];
+        float    scale;
+        float    lower[3];
+        float    upper[3];
+    };
+
+    bool loadParticleCache(
+        const std::string                     &filename,
+        agz::thread::thread_group_t           &threadGroup,
+        int                                    threadCount,
+        std::vector<ParticleLoader::Particle> &particles)
+    {
+        auto cache = ColumnCache::open(
+            filename, PARTICLE_CACHE_FORMAT, sizeof(ParticleCacheMetadata));
+        if(!cache || cache->getColumnCount() != 4)
+            return false;
+
+        ParticleCacheMetadata metadata;
+        std::memcpy(&metadata, cache->getMetadata(), sizeof(metadata));
+
+        const float *columns[4];
+        for(size_t i = 0; i < 4; ++i)
+        {
+            size_t count;
+            columns[i] = cache->getColumn<float>(i, &count);
+            if(!columns[i] || count != metadata.particleCount)
+                return false;
+        }
+
+        particles.resize(metadata.particleCount);
+
+        parallelForBlocks(
+            threadGroup, threadCount, particles.size(), 1 << 16,
+            [&](int, size_t beg, size_t end)
+        {
+            for(size_t i = beg; i < end; ++i)
+            {
+                particles[i].position = {
+                    columns[0][i], columns[1][i], columns[2][i]
+                };
+                particles[i].colorBy = columns[3][i];
+            }
+        });
+
+        return true;
+    }
+
+    void saveParticleCache(
+        const std::string                           &filename,
+        agz::thread::thread_group_t                 &threadGroup,
+        int                                          threadCount,
+        const std::vector<ParticleLoader::Particle> &particles,
+        const Vec3                                  &offset,
+        float                                        scale)
+    {
+        std::vector<float> columns[4];
+        for(auto &c : columns)
+            c.resize(particles.size());
+
+        std::vector<Vec3> threadL(
+            threadCount, Vec3(std::numeric_limits<float>::max()));
+        std::vector<Vec3> threadH(
+            threadCount, Vec3(std::numeric_limits<float>::lowest()));
+
+        parallelForBlocks(
+            threadGroup, threadCount, particles.size(), 1 << 16,
+            [&](int threadIndex, size_t beg, size_t end)
+        {
+            Vec3 L = threadL[threadIndex], H = threadH[threadIndex];
+            for(size_t i = beg; i < end; ++i)
+            {
+                const auto &p = particles[i];
+                columns[0][i] = p.position.x;
+                columns[1][i] = p.position.y;
+                columns[2][i] = p.position.z;
+                columns[3][i] = p.colorBy;
+                L = elem_min(L, p.position);
+                H = elem_max(H, p.position);
+            }
+            threadL[threadIndex] = L;
+            threadH[threadIndex] = H;
+        });
+
+        Vec3 L(std::numeric_limits<float>::max());
+        Vec3 H(std::numeric_limits<float>::lowest());
+        for(int i = 0; i < threadCount; ++i)
+        {
+            L = elem_min(L, threadL[i]);
+            H = elem_max(H, threadH[i]);
+        }
+
+        ParticleCacheMetadata metadata = {};
+        metadata.particleCount = particles.size();
+        metadata.scale         = scale;
+        for(int i = 0; i < 3; ++i)
+        {
+            metadata.offset[i] = offset[i];
+            metadata.lower[i]  = L[i];
+            metadata.upper[i]  = H[i];
+        }
+
+        std::vector<ColumnCache::Column> cacheColumns;
+        for(auto &c : columns)
+            cacheColumns.push_back({ c.data(), c.size() * sizeof(float) });
+
+        if(!ColumnCache::write(
+            filename, PARTICLE_CACHE_FORMAT,
+            &metadata, sizeof(metadata), cacheColumns))
+        {
+            std::cerr << "failed to write particle cache of "
+                      << filename << std::endl;
+        }
+    }
 }
 
-void ParticleLoader::loadFromXML(const std::string &filename)
+void ParticleLoader::loadFromXML(
+    const std::string           &filename,
+    agz::thread::thread_group_t &threadGroup)
 {
     allParticles_.clear();
 
+    const int threadCount = agz::thread::actual_worker_count(-1);
+
+    if(loadParticleCache(filename, threadGroup, threadCount, allParticles_))
+        return;
+
+    // parse in place without escaping or eol normalization, so that only
+    // the pages holding string terminators are copied from the mapped file
+
+    MappedFile file(filename);
+
     pugi::xml_document doc;
-    if(!doc.load_file(filename.c_str()))
+    if(!doc.load_buffer_inplace(
+        file.data(), file.size(), pugi::parse_minimal, pugi::encoding_utf8))
         throw std::runtime_error("failed to load/parse xml file: " + filename);
 
     const auto indices = findParticlePositionIndices(doc);
 
+    std::vector<ParticleXMLData> sections;
     for(auto section : doc.child("ParticleTracks").child("Tracks"))
     {
-        if(section.name() != std::string_view("Section"))
-            continue;
-
-        auto data = findPositionData(section, indices);
-        auto xData = base64ToFloatArray(data.x.text().get());
-        auto yData = base64ToFloatArray(data.y.text().get());
-        auto zData = base64ToFloatArray(data.z.text().get());
-        auto colorByData = base64ToFloatArray(data.colorBy.text().get());
-
-        if(xData.size() != yData.size() ||
-           xData.size() != zData.size() ||
-           xData.size() != colorByData.size())
+        if(section.name() == std::string_view("Section"))
+            sections.push_back(findPositionData(section, indices));
+    }
+
+    // particle count of each section
+
+    std::vector<size_t> sectionOffsets(sections.size() + 1, 0);
+
+    parallelForBlocks(
+        threadGroup, threadCount, sections.size(), 1,
+        [&](int, size_t i, size_t)
+    {
+        auto &data = sections[i];
+        const size_t count = base64FloatCount(data.x.text().get());
+
+        if(count != base64FloatCount(data.y.text().get()) ||
+           count != base64FloatCount(data.z.text().get()) ||
+           count != base64FloatCount(data.colorBy.text().get()))
             throw std::runtime_error("x/y/z data sizes are unmatched");
 
-        for(size_t i = 0; i < xData.size(); ++i)
+        sectionOffsets[i + 1] = count;
+    });
+
+    for(size_t i = 1; i < sectionOffsets.size(); ++i)
+        sectionOffsets[i] += sectionOffsets[i - 1];
+
+    // decode sections into their own ranges of allParticles_
+
+    allParticles_.resize(sectionOffsets.back());
+
+    std::vector<Vec3> threadL(
+        threadCount, Vec3(std::numeric_limits<float>::max()));
+    std::vector<Vec3> threadH(
+        threadCount, Vec3(std::numeric_limits<float>::lowest()));
+
+    parallelForBlocks(
+        threadGroup, threadCount, sections.size(), 1,
+        [&](int threadIndex, size_t i, size_t)
+    {
+        auto &data = sections[i];
+        const size_t count = sectionOffsets[i + 1] - sectionOffsets[i];
+
+        std::vector<float> xData(count), yData(count), zData(count);
+        std::vector<float> colorByData(count);
+        base64ToFloatArray(data.x.text().get(), xData.data(), count);
+        base64ToFloatArray(data.y.text().get(), yData.data(), count);
+        base64ToFloatArray(data.z.text().get(), zData.data(), count);
+        base64ToFloatArray(
+            data.colorBy.text().get(), colorByData.data(), count);
+
+        Vec3 L = threadL[threadIndex], H = threadH[threadIndex];
+
+        Particle *output = allParticles_.data() + sectionOffsets[i];
+        for(size_t j = 0; j < count; ++j)
         {
-            allParticles_.push_back(
-                { { xData[i], yData[i], zData[i] }, colorByData[i] });
+            output[j] = { { xData[j], yData[j], zData[j] }, colorByData[j] };
+            L = elem_min(L, output[j].position);
+            H = elem_max(H, output[j].position);
         }
-    }
+
+        threadL[threadIndex] = L;
+        threadH[threadIndex] = H;
+    });
 
     Vec3 L(std::numeric_limits<float>::max());
     Vec3 H(std::numeric_limits<float>::lowest());
-    for(auto &p : allParticles_)
+    for(int i = 0; i < threadCount; ++i)
     {
-        L = elem_min(L, p.position);
-        H = elem_max(H, p.position);
+        L = elem_min(L, threadL[i]);
+        H = elem_max(H, threadH[i]);
     }
 
     const Vec3 offset = -0.5f * (L + H);
     const float scale = 1 / (std::max)((H - L).max_elem(), 0.001f);
 
-    for(auto &p : allParticles_)
-        p.position = scale * (p.position + offset);
+    parallelForBlocks(
+        threadGroup, threadCount, allParticles_.size(), 1 << 16,
+        [&](int, size_t beg, size_t end)
+    {
+        for(size_t i = beg; i < end; ++i)
+        {
+            auto &p = allParticles_[i];
+            p.position = scale * (p.position + offset);
+        }
+    });
+
+    saveParticleCache(
+        filename, threadGroup, threadCount, allParticles_, offset, scale);
 }
 
 const std::vector<ParticleLoader::Particle> &
@@ -1,27 +1,42 @@
+#include <algorithm>
 #include <iostream>
+#include <queue>
 #include <random>
 
 #include <QMouseEvent>
 #include <QOpenGLDebugLogger>
 #include <QPainter>
 #include <QTimer>
+#include <QVector2D>
 
 #include <agz/utility/mesh.h>
 
+#include <crius/common/frustum.h>
 #include <crius/particle/particleRenderer.h>
+#include <crius/utility/morton.h>
+#include <crius/utility/parallelFor.h>
+#include <crius/utility/radixSort.h>
 
 namespace
 {
 
+    // instance offsets are quantized relative to the bound of their chunk,
+    // which is fetched from chunkBounds as (lower, extent) texel pairs.
+    // instance colors are given by a scalar looked up in colorMap
+
     const char PARTICLE_VS[] = R"___(
     #version 330 core
 
     uniform mat4 projView;
+    uniform samplerBuffer chunkBounds;
+    uniform sampler1D colorMap;
+    uniform int chunkSize;
+    uniform int firstInstance;
 
     in vec3 position;
     in vec3 normal;
     in vec3 offset;
-    in vec3 color;
+    in float value;
 
     out vec3 w_normal;
     out vec3 w_position;
@@ -30,11 +45,16 @@ namespace
 
     void main()
     {
+        int chunk = (firstInstance + gl_InstanceID) / chunkSize;
+        vec3 lower  = texelFetch(chunkBounds, 2 * chunk).xyz;
+        vec3 extent = texelFetch(chunkBounds, 2 * chunk + 1).xyz;
+        vec3 center = lower + offset * extent;
+
         w_normal = normal;
-        w_offset = offset;
-        w_position = position + offset;
-        o_color = color;
-        gl_Position = projView * vec4(position + offset, 1);
+        w_offset = center;
+        w_position = position + center;
+        o_color = texture(colorMap, value).rgb;
+        gl_Position = projView * vec4(position + center, 1);
     }
 )___";
 
@@ -66,16 +86,194 @@ namespace
     }
     )___";
 
+    // each particle is drawn as a point sprite covering its projected
+    // sphere. the fragment shader intersects the view ray with the sphere to
+    // get the surface point, normal and depth
+
+    const char IMPOSTOR_VS[] = R"___(
+    #version 330 core
+
+    uniform mat4 projView;
+    uniform vec3 eyePosition;
+    uniform vec3 cameraDir;
+    uniform bool perspective;
+    uniform float pointSizeScale;
+    uniform samplerBuffer chunkBounds;
+    uniform sampler1D colorMap;
+    uniform int chunkSize;
+    uniform bool quantized;
+
+    in vec3 offset;
+    in float value;
+    in float radius;
+
+    out vec3 o_center;
+    out vec3 o_color;
+    out float o_radius;
+
+    void main()
+    {
+        vec3 center = offset;
+        if(quantized)
+        {
+            int chunk = gl_VertexID / chunkSize;
+            vec3 lower  = texelFetch(chunkBounds, 2 * chunk).xyz;
+            vec3 extent = texelFetch(chunkBounds, 2 * chunk + 1).xyz;
+            center = lower + offset * extent;
+        }
+
+        o_center = center;
+        o_color = texture(colorMap, value).rgb;
+        o_radius = radius;
+        gl_Position = projView * vec4(center, 1);
+
+        float depth = dot(center - eyePosition, cameraDir);
+        gl_PointSize = 2 + radius * (perspective ?
+            pointSizeScale / max(depth, 1e-4) : pointSizeScale);
+    }
+    )___";
+
+    const char IMPOSTOR_FS[] = R"___(
+    #version 330 core
+
+    uniform mat4 projView;
+    uniform mat4 invProjView;
+    uniform vec2 viewportSize;
+    uniform vec3 eyePosition;
+    uniform vec3 cameraDir;
+    uniform float nearClipDistance;
+    uniform float farClipDistance;
+    in vec3 o_center;
+    in vec3 o_color;
+    in float o_radius;
+
+    out vec4 frag_color;
+
+    void main()
+    {
+        float dis = dot(o_center - eyePosition, cameraDir);
+        if(dis < nearClipDistance || dis > farClipDistance)
+            discard;
+
+        vec2 ndc = 2 * gl_FragCoord.xy / viewportSize - 1;
+        vec4 nearPos = invProjView * vec4(ndc, -1, 1);
+        vec4 farPos  = invProjView * vec4(ndc, 1, 1);
+        vec3 ro = nearPos.xyz / nearPos.w;
+        vec3 rd = normalize(farPos.xyz / farPos.w - ro);
+
+        vec3 oc = ro - o_center;
+        float b = dot(oc, rd);
+        float c = dot(oc, oc) - o_radius * o_radius;
+        float h = b * b - c;
+        if(h < 0)
+            discard;
+
+        vec3 position = ro + (-b - sqrt(h)) * rd;
+        vec3 normal = (position - o_center) / o_radius;
+
+        vec4 clipPos = projView * vec4(position, 1);
+        gl_FragDepth = 0.5 * clipPos.z / clipPos.w + 0.5;
+
+        vec3 posToEye = normalize(eyePosition - position);
+        float light_factor = min(0.2 + max(0, dot(posToEye, normal)), 1);
+        frag_color = vec4(light_factor * o_color, 1);
+    }
+    )___";
+
+    // each particle adds a weighted footprint to the density target, which
+    // stores the weighted color sum and the total weight
+
+    const char DENSITY_FS[] = R"___(
+    #version 330 core
+
+    uniform vec3 eyePosition;
+    uniform vec3 cameraDir;
+    uniform float nearClipDistance;
+    uniform float farClipDistance;
+    uniform float weightScale;
+
+    in vec3 o_center;
+    in vec3 o_color;
+    in float o_radius;
+
+    out vec4 frag_color;
+
+    void main()
+    {
+        float dis = dot(o_center - eyePosition, cameraDir);
+        if(dis < nearClipDistance || dis > farClipDistance)
+            discard;
+
+        vec2 d = 2 * gl_PointCoord - 1;
+        float weight = weightScale * max(0, 1 - dot(d, d));
+        frag_color = weight * vec4(o_color, 1);
+    }
+    )___";
+
+    const char DENSITY_RESOLVE_VS[] = R"___(
+    #version 330 core
+
+    void main()
+    {
+        vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+        gl_Position = vec4(2 * p - 1, 0, 1);
+    }
+    )___";
+
+    // mean color of a pixel is faded into the background by its total weight
+
+    const char DENSITY_RESOLVE_FS[] = R"___(
+    #version 330 core
+
+    uniform sampler2D density;
+    uniform float intensity;
+    uniform vec3 background;
+
+    out vec4 frag_color;
+
+    void main()
+    {
+        vec4 sum = texelFetch(density, ivec2(gl_FragCoord.xy), 0);
+        vec3 color = sum.a > 0 ? sum.rgb / sum.a : background;
+        float coverage = 1 - exp(-intensity * sum.a);
+        frag_color = vec4(mix(background, color, coverage), 1);
+    }
+    )___";
+
+    constexpr float BACKGROUND_COLOR[3] = { 0, 0.3f, 0.3f };
+
     constexpr float PERSPECTIVE_FOV_RAD = agz::math::deg2rad(40.0f);
 
     constexpr float ORTHO_HEIGHT_OVER_DISTANCE = 0.72794f;
 
+    // particle mesh is scaled by this when loaded, which also bounds the
+    // distance from a particle's center to its surface
+    constexpr float PARTICLE_MESH_SCALE = 0.04f;
+
+    constexpr int CHUNK_SIZE = 4096;
+
+    // each splat node aggregates its chunks on a grid of SPLAT_GRID_SIZE^3
+    // cells fitted to the node bound
+    constexpr int SPLAT_GRID_SIZE = 6;
+
+    // max projected size of aggregation cells for a node to draw its splats
+    constexpr float SPLAT_IDLE_PIXELS        = 2.0f;
+    constexpr float SPLAT_INTERACTIVE_PIXELS = 6.0f;
+
+    // max number of particles and splats drawn in a frame. nodes keep their
+    // splats once refining them would exceed it
+    constexpr int IDLE_PRIMITIVE_BUDGET        = 16000000;
+    constexpr int INTERACTIVE_PRIMITIVE_BUDGET = 500000;
+
 } // namespace anonymous
 
 ParticleRenderer::ParticleRenderer(
-    QWidget              *parent,
-    std::vector<Particle> particles)
-    : QOpenGLWidget(parent), particles_(std::move(particles))
+    QWidget                        *parent,
+    std::vector<Particle>           particles,
+    std::vector<agz::math::color3f> colorMap,
+    agz::thread::thread_group_t    &threadGroup)
+    : QOpenGLWidget(parent),
+      particles_(std::move(particles)), colorMap_(std::move(colorMap))
 {
     // gl core profile version
 
@@ -96,6 +294,8 @@ ParticleRenderer::ParticleRenderer(
     vertexCount_ = 0;
     instanceCount_ = 0;
 
+    buildChunks(threadGroup);
+
     wheelTimer_ = new QTimer(this);
     wheelTimer_->setSingleShot(true);
     connect(wheelTimer_, &QTimer::timeout,
@@ -116,6 +316,21 @@ ParticleRenderer::~ParticleRenderer()
     particleVertices_.destroy();
     particleInstanceData_.destroy();
     particleVAO_.destroy();
+    impostorVAO_.destroy();
+    splatData_.destroy();
+    splatVAO_.destroy();
+
+    if(chunkBoundTexture_)
+        glDeleteTextures(1, &chunkBoundTexture_);
+    chunkBoundBuffer_.destroy();
+    if(colorMapTexture_)
+        glDeleteTextures(1, &colorMapTexture_);
+
+    densityResolveVAO_.destroy();
+    if(densityFramebuffer_)
+        glDeleteFramebuffers(1, &densityFramebuffer_);
+    if(densityTexture_)
+        glDeleteTextures(1, &densityTexture_);
 
     doneCurrent();
 }
@@ -145,12 +360,37 @@ void ParticleRenderer::initializeGL()
         QOpenGLShader::Vertex, PARTICLE_VS);
     particleShader_.addShaderFromSourceCode(
         QOpenGLShader::Fragment, PARTICLE_FS);
-    particleShader_.link();
-
     particleShader_.bindAttributeLocation("position", 0);
     particleShader_.bindAttributeLocation("normal", 1);
     particleShader_.bindAttributeLocation("offset", 2);
-    particleShader_.bindAttributeLocation("color", 3);
+    particleShader_.bindAttributeLocation("value", 3);
+    particleShader_.link();
+
+    impostorShader_.addShaderFromSourceCode(
+        QOpenGLShader::Vertex, IMPOSTOR_VS);
+    impostorShader_.addShaderFromSourceCode(
+        QOpenGLShader::Fragment, IMPOSTOR_FS);
+    impostorShader_.bindAttributeLocation("offset", 2);
+    impostorShader_.bindAttributeLocation("value", 3);
+    impostorShader_.bindAttributeLocation("radius", 4);
+    impostorShader_.link();
+
+    densityShader_.addShaderFromSourceCode(
+        QOpenGLShader::Vertex, IMPOSTOR_VS);
+    densityShader_.addShaderFromSourceCode(
+        QOpenGLShader::Fragment, DENSITY_FS);
+    densityShader_.bindAttributeLocation("offset", 2);
+    densityShader_.bindAttributeLocation("value", 3);
+    densityShader_.bindAttributeLocation("radius", 4);
+    densityShader_.link();
+
+    densityResolveShader_.addShaderFromSourceCode(
+        QOpenGLShader::Vertex, DENSITY_RESOLVE_VS);
+    densityResolveShader_.addShaderFromSourceCode(
+        QOpenGLShader::Fragment, DENSITY_RESOLVE_FS);
+    densityResolveShader_.link();
+
+    densityResolveVAO_.create();
 
     // particle mesh
 
@@ -161,12 +401,17 @@ void ParticleRenderer::initializeGL()
     {
         for(int i = 0; i < 3; ++i)
         {
-            vertices.push_back(
-                { 0.04f * tri.vertices[i].position, tri.vertices[i].normal });
+            vertices.push_back({
+                PARTICLE_MESH_SCALE * tri.vertices[i].position,
+                tri.vertices[i].normal });
         }
     }
     vertexCount_ = static_cast<int>(vertices.size());
 
+    particleRadius_ = 0;
+    for(auto &v : vertices)
+        particleRadius_ = (std::max)(particleRadius_, v.position.length());
+
     particleVertices_.create();
     particleVertices_.bind();
     particleVertices_.allocate(
@@ -175,7 +420,7 @@ void ParticleRenderer::initializeGL()
 
     // particle data
 
-    setParticles(particles_.size());
+    setParticles();
 }
 
 void ParticleRenderer::useDefaultCamera()
@@ -199,6 +444,24 @@ void ParticleRenderer::setRenderedCount(int renderedCount)
     update();
 }
 
+void ParticleRenderer::useImpostors(bool impostors)
+{
+    useImpostors_ = impostors;
+    update();
+}
+
+void ParticleRenderer::useDensityMode(bool density)
+{
+    densityMode_ = density;
+    update();
+}
+
+void ParticleRenderer::setDensityIntensity(float intensity)
+{
+    densityIntensity_ = intensity;
+    update();
+}
+
 void ParticleRenderer::setNearClipDistance(float distance)
 {
     nearClipDistance_ = distance;
@@ -211,9 +474,10 @@ void ParticleRenderer::setFarClipDistance(float distance)
     update();
 }
 
-void ParticleRenderer::setParticles(int renderedCount)
+void ParticleRenderer::buildChunks(agz::thread::thread_group_t &threadGroup)
 {
-    assert(0 < renderedCount && renderedCount <= particles_.size());
+    const int threadCount = agz::thread::actual_worker_count(-1);
+    const int particleCount = static_cast<int>(particles_.size());
 
     boundingBox_.lower = Vec3(std::numeric_limits<float>::max());
     boundingBox_.upper = Vec3(std::numeric_limits<float>::lowest());
@@ -223,21 +487,340 @@ void ParticleRenderer::setParticles(int renderedCount)
         boundingBox_.upper = elem_max(boundingBox_.upper, p.offset);
     }
 
-    std::vector<Particle> instanceData = particles_;
+    // sort by morton code
 
-    std::default_random_engine rng{ std::random_device()() };
-    std::shuffle(std::begin(instanceData), std::end(instanceData), rng);
+    std::vector<uint64_t> keys(particleCount);
+    std::vector<uint32_t> order(particleCount);
 
-    instanceCount_ = static_cast<int>(particles_.size());
-    renderedCount_ = renderedCount;
+    parallelForBlocks(
+        threadGroup, threadCount, particleCount, CHUNK_SIZE,
+        [&](int, size_t beg, size_t end)
+    {
+        for(size_t i = beg; i < end; ++i)
+        {
+            keys[i]  = mortonCode(Vec3(particles_[i].offset), boundingBox_);
+            order[i] = static_cast<uint32_t>(i);
+        }
+    });
 
-    particleInstanceData_.destroy();
-    particleInstanceData_.create();
-    particleInstanceData_.bind();
-    particleInstanceData_.allocate(
-        instanceData.data(),
-        static_cast<int>(sizeof(Particle) * instanceData.size()));
-    particleInstanceData_.release();
+    parallelRadixSort(keys, order, threadGroup, threadCount);
+    keys = std::vector<uint64_t>();
+
+    std::vector<Particle> sortedParticles(particleCount);
+    parallelForBlocks(
+        threadGroup, threadCount, particleCount, CHUNK_SIZE,
+        [&](int, size_t beg, size_t end)
+    {
+        for(size_t i = beg; i < end; ++i)
+            sortedParticles[i] = particles_[order[i]];
+    });
+    particles_.swap(sortedParticles);
+    sortedParticles = std::vector<Particle>();
+    order           = std::vector<uint32_t>();
+
+    // chunk bounds, and shuffle in each chunk
+
+    const int chunkCount = (particleCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunks_.resize(chunkCount);
+
+    const unsigned seed = std::random_device()();
+    parallelForBlocks(
+        threadGroup, threadCount, chunkCount, 1,
+        [&](int, size_t chunkIndex, size_t)
+    {
+        auto &chunk = chunks_[chunkIndex];
+        chunk.first = static_cast<int>(chunkIndex) * CHUNK_SIZE;
+        chunk.count = (std::min)(CHUNK_SIZE, particleCount - chunk.first);
+
+        chunk.bound.lower = Vec3(std::numeric_limits<float>::max());
+        chunk.bound.upper = Vec3(std::numeric_limits<float>::lowest());
+
+        auto beg = particles_.begin() + chunk.first;
+        auto end = beg + chunk.count;
+        for(auto it = beg; it != end; ++it)
+        {
+            chunk.bound.lower = elem_min(chunk.bound.lower, Vec3(it->offset));
+            chunk.bound.upper = elem_max(chunk.bound.upper, Vec3(it->offset));
+        }
+
+        std::default_random_engine rng(
+            seed + static_cast<unsigned>(chunkIndex));
+        std::shuffle(beg, end, rng);
+    });
+
+    buildSplats(threadGroup);
+
+    // quantize offsets relative to chunk bounds
+
+    quantizedParticles_.resize(particleCount);
+    parallelForBlocks(
+        threadGroup, threadCount, chunkCount, 1,
+        [&](int, size_t chunkIndex, size_t)
+    {
+        const auto &chunk = chunks_[chunkIndex];
+        const Vec3 extent = chunk.bound.upper - chunk.bound.lower;
+        const Vec3 scale = {
+            extent.x > 0 ? 65535 / extent.x : 0.0f,
+            extent.y > 0 ? 65535 / extent.y : 0.0f,
+            extent.z > 0 ? 65535 / extent.z : 0.0f
+        };
+
+        const auto quantize = [](float x)
+        {
+            return static_cast<uint16_t>(
+                agz::math::clamp(x, 0.0f, 65535.0f) + 0.5f);
+        };
+
+        for(int i = chunk.first; i < chunk.first + chunk.count; ++i)
+        {
+            const Vec3 local = Vec3(particles_[i].offset) - chunk.bound.lower;
+            auto &q = quantizedParticles_[i];
+            q.offset[0] = quantize(local.x * scale.x);
+            q.offset[1] = quantize(local.y * scale.y);
+            q.offset[2] = quantize(local.z * scale.z);
+            q.value     = quantize(particles_[i].value * 65535);
+        }
+    });
+
+    particles_ = std::vector<Particle>();
+}
+
+void ParticleRenderer::buildSplats(agz::thread::thread_group_t &threadGroup)
+{
+    const int threadCount = agz::thread::actual_worker_count(-1);
+    const int chunkCount = static_cast<int>(chunks_.size());
+
+    // splats of a node lie on a grid of SPLAT_GRID_SIZE^3 cells fitted to its
+    // bound. each occupied cell yields one splat at the centroid of what falls
+    // into it, with the average scalar. leaves aggregate the particles of
+    // their chunk, and parents the splats of their children weighted by the
+    // particle counts they stand for. a splat has the volume of the particles
+    // it stands for, but never grows beyond its cell
+
+    constexpr int G = SPLAT_GRID_SIZE;
+
+    struct Cell
+    {
+        Vec3  position;
+        float value;
+        int   count;
+    };
+
+    std::vector<std::vector<Splat>> nodeSplats;
+    std::vector<std::vector<int>>   nodeSplatCounts;
+
+    // forEachInput calls its argument with (position, value, count) of each
+    // particle or child splat of the node
+    const auto aggregate = [&](int nodeIndex, const auto &forEachInput)
+    {
+        auto &node = splatNodes_[nodeIndex];
+
+        const Vec3 extent = node.bound.upper - node.bound.lower;
+        const float cellSize = (std::max)(
+            (std::max)(extent.x, extent.y), extent.z) / G;
+        node.splatCellSize = cellSize;
+
+        std::vector<Cell> cells(G * G * G, Cell{ Vec3(0), 0.0f, 0 });
+        forEachInput([&](const Vec3 &position, float value, int count)
+        {
+            const Vec3 local = (position - node.bound.lower)
+                             / (std::max)(cellSize, 1e-20f);
+            const int x = agz::math::clamp(static_cast<int>(local.x), 0, G - 1);
+            const int y = agz::math::clamp(static_cast<int>(local.y), 0, G - 1);
+            const int z = agz::math::clamp(static_cast<int>(local.z), 0, G - 1);
+
+            auto &cell = cells[(z * G + y) * G + x];
+            cell.position += static_cast<float>(count) * position;
+            cell.value    += count * value;
+            cell.count    += count;
+        });
+
+        const float maxRadius = 0.5f * std::sqrt(3.0f) * cellSize;
+
+        auto &splats = nodeSplats[nodeIndex];
+        auto &counts = nodeSplatCounts[nodeIndex];
+        node.maxSplatRadius = 0;
+        for(auto &cell : cells)
+        {
+            if(!cell.count)
+                continue;
+
+            const float invCount = 1.0f / cell.count;
+            const float radius = (std::min)(
+                maxRadius,
+                PARTICLE_MESH_SCALE * std::cbrt(static_cast<float>(cell.count)));
+
+            Splat splat;
+            splat.offset = invCount * cell.position;
+            splat.value  = invCount * cell.value;
+            splat.radius = radius;
+            splats.push_back(splat);
+            counts.push_back(cell.count);
+
+            node.maxSplatRadius = (std::max)(node.maxSplatRadius, radius);
+        }
+        node.splatCount = static_cast<int>(splats.size());
+    };
+
+    // leaves
+
+    splatNodes_.resize(chunkCount);
+    nodeSplats.resize(chunkCount);
+    nodeSplatCounts.resize(chunkCount);
+
+    parallelForBlocks(
+        threadGroup, threadCount, chunkCount, 1,
+        [&](int, size_t chunkIndex, size_t)
+    {
+        const auto &chunk = chunks_[chunkIndex];
+
+        auto &node = splatNodes_[chunkIndex];
+        node.bound       = chunk.bound;
+        node.firstChunk  = static_cast<int>(chunkIndex);
+        node.chunkCount  = 1;
+        node.children[0] = -1;
+        node.children[1] = -1;
+
+        aggregate(static_cast<int>(chunkIndex), [&](const auto &addInput)
+        {
+            for(int i = chunk.first; i < chunk.first + chunk.count; ++i)
+                addInput(Vec3(particles_[i].offset), particles_[i].value, 1);
+        });
+    });
+
+    // pairs of adjacent nodes are merged level by level until a single root
+    // is left. the last node of a level with an odd size gets no sibling
+
+    int levelFirst = 0, levelCount = chunkCount;
+    while(levelCount > 1)
+    {
+        const int parentFirst = levelFirst + levelCount;
+        const int parentCount = (levelCount + 1) / 2;
+
+        splatNodes_.resize(parentFirst + parentCount);
+        nodeSplats.resize(parentFirst + parentCount);
+        nodeSplatCounts.resize(parentFirst + parentCount);
+
+        parallelForBlocks(
+            threadGroup, threadCount, parentCount, 1,
+            [&](int, size_t parentIndex, size_t)
+        {
+            const int nodeIndex = parentFirst + static_cast<int>(parentIndex);
+            const int left = levelFirst + 2 * static_cast<int>(parentIndex);
+            const int right = left + 1 < parentFirst ? left + 1 : -1;
+
+            auto &node = splatNodes_[nodeIndex];
+            node.bound       = splatNodes_[left].bound;
+            node.firstChunk  = splatNodes_[left].firstChunk;
+            node.chunkCount  = splatNodes_[left].chunkCount;
+            node.children[0] = left;
+            node.children[1] = right;
+            if(right >= 0)
+            {
+                const auto &rightBound = splatNodes_[right].bound;
+                node.bound.lower = elem_min(node.bound.lower, rightBound.lower);
+                node.bound.upper = elem_max(node.bound.upper, rightBound.upper);
+                node.chunkCount += splatNodes_[right].chunkCount;
+            }
+
+            aggregate(nodeIndex, [&](const auto &addInput)
+            {
+                for(int child : node.children)
+                {
+                    if(child < 0)
+                        continue;
+                    const auto &splats = nodeSplats[child];
+                    const auto &counts = nodeSplatCounts[child];
+                    for(size_t i = 0; i < splats.size(); ++i)
+                    {
+                        addInput(
+                            Vec3(splats[i].offset), splats[i].value, counts[i]);
+                    }
+                }
+            });
+
+            for(int child : node.children)
+            {
+                if(child >= 0)
+                {
+                    node.maxSplatRadius = (std::max)(
+                        node.maxSplatRadius, splatNodes_[child].maxSplatRadius);
+                }
+            }
+        });
+
+        levelFirst = parentFirst;
+        levelCount = parentCount;
+    }
+
+    const int nodeCount = static_cast<int>(splatNodes_.size());
+
+    int splatCount = 0;
+    for(int i = 0; i < nodeCount; ++i)
+    {
+        splatNodes_[i].splatFirst = splatCount;
+        splatCount += splatNodes_[i].splatCount;
+    }
+
+    splats_.resize(splatCount);
+    parallelForBlocks(
+        threadGroup, threadCount, nodeCount, 1,
+        [&](int, size_t nodeIndex, size_t)
+    {
+        std::copy(
+            nodeSplats[nodeIndex].begin(), nodeSplats[nodeIndex].end(),
+            splats_.begin() + splatNodes_[nodeIndex].splatFirst);
+    });
+}
+
+void ParticleRenderer::setParticles()
+{
+    instanceCount_ = static_cast<int>(quantizedParticles_.size());
+    renderedCount_ = instanceCount_;
+
+    if(!particleInstanceData_.isCreated())
+        particleInstanceData_.create(this);
+    particleInstanceData_.setData(
+        quantizedParticles_.data(),
+        sizeof(QuantizedParticle) * quantizedParticles_.size());
+
+    // chunk bounds for dequantization
+
+    std::vector<Vec4> chunkBounds;
+    chunkBounds.reserve(2 * chunks_.size());
+    for(auto &chunk : chunks_)
+    {
+        const Vec3 extent = chunk.bound.upper - chunk.bound.lower;
+        chunkBounds.push_back(Vec4(
+            chunk.bound.lower.x, chunk.bound.lower.y, chunk.bound.lower.z, 0));
+        chunkBounds.push_back(Vec4(
+            extent.x, extent.y, extent.z, 0));
+    }
+
+    if(!chunkBoundBuffer_.isCreated())
+        chunkBoundBuffer_.create(this);
+    chunkBoundBuffer_.setData(
+        chunkBounds.data(), sizeof(Vec4) * chunkBounds.size());
+
+    if(!chunkBoundTexture_)
+        glGenTextures(1, &chunkBoundTexture_);
+    glBindTexture(GL_TEXTURE_BUFFER, chunkBoundTexture_);
+    glTexBuffer(
+        GL_TEXTURE_BUFFER, GL_RGBA32F, chunkBoundBuffer_.getHandle());
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    // color map
+
+    if(!colorMapTexture_)
+        glGenTextures(1, &colorMapTexture_);
+    glBindTexture(GL_TEXTURE_1D, colorMapTexture_);
+    glTexImage1D(
+        GL_TEXTURE_1D, 0, GL_RGB32F, static_cast<GLsizei>(colorMap_.size()),
+        0, GL_RGB, GL_FLOAT, colorMap_.data());
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_1D, 0);
 
     particleVAO_.destroy();
     particleVAO_.create();
@@ -256,31 +839,143 @@ void ParticleRenderer::setParticles(int renderedCount)
         reinterpret_cast<void*>(offsetof(ParticleVertex, normal)));
     particleVertices_.release();
 
-    particleInstanceData_.bind();
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(
-        2, 3, GL_FLOAT, false,
-        sizeof(Particle),
-        reinterpret_cast<void *>(offsetof(Particle, offset)));
     glVertexAttribDivisor(2, 1);
-
     glEnableVertexAttribArray(3);
-    glVertexAttribPointer(
-        3, 3, GL_FLOAT, false,
-        sizeof(Particle),
-        reinterpret_cast<void *>(offsetof(Particle, color)));
     glVertexAttribDivisor(3, 1);
-    particleInstanceData_.release();
+    bindInstanceData(0);
 
     particleVAO_.release();
 
-    particles_.clear();
+    // impostors read instance data as per-vertex points
+
+    impostorVAO_.destroy();
+    impostorVAO_.create();
+    impostorVAO_.bind();
+
+    glEnableVertexAttribArray(2);
+    glEnableVertexAttribArray(3);
+    bindInstanceData(0);
+
+    impostorVAO_.release();
+
+    // aggregated splats of chunks
+
+    if(!splatData_.isCreated())
+        splatData_.create(this);
+    splatData_.setData(splats_.data(), sizeof(Splat) * splats_.size());
+
+    splatVAO_.destroy();
+    splatVAO_.create();
+    splatVAO_.bind();
+
+    glBindBuffer(GL_ARRAY_BUFFER, splatData_.getHandle());
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(
+        2, 3, GL_FLOAT, false,
+        sizeof(Splat),
+        reinterpret_cast<void *>(offsetof(Splat, offset)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(
+        3, 1, GL_FLOAT, false,
+        sizeof(Splat),
+        reinterpret_cast<void *>(offsetof(Splat, value)));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(
+        4, 1, GL_FLOAT, false,
+        sizeof(Splat),
+        reinterpret_cast<void *>(offsetof(Splat, radius)));
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    splatVAO_.release();
+
+    // gpu buffers are the only copies from now on
+    quantizedParticles_ = std::vector<QuantizedParticle>();
+    splats_             = std::vector<Splat>();
     useDefaultCamera();
 }
 
+void ParticleRenderer::prepareDensityTarget(int width, int height)
+{
+    if(densityFramebuffer_ &&
+       densityTargetWidth_ == width && densityTargetHeight_ == height)
+        return;
+
+    if(!densityTexture_)
+        glGenTextures(1, &densityTexture_);
+    // sums of millions of weights, scaled up when drawing a subset, overflow
+    // half floats and stop growing long before that. 32-bit float targets
+    // are color-renderable and blendable in any gl 3.3 core context
+    glBindTexture(GL_TEXTURE_2D, densityTexture_);
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_RGBA32F, width, height,
+        0, GL_RGBA, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if(!densityFramebuffer_)
+        glGenFramebuffers(1, &densityFramebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, densityFramebuffer_);
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+        GL_TEXTURE_2D, densityTexture_, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+
+    densityTargetWidth_  = width;
+    densityTargetHeight_ = height;
+}
+
+void ParticleRenderer::resolveDensity()
+{
+    densityResolveVAO_.bind();
+    densityResolveShader_.bind();
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, densityTexture_);
+
+    densityResolveShader_.setUniformValue(
+        densityResolveShader_.uniformLocation("density"), 2);
+    densityResolveShader_.setUniformValue(
+        densityResolveShader_.uniformLocation("intensity"), densityIntensity_);
+    densityResolveShader_.setUniformValue(
+        densityResolveShader_.uniformLocation("background"),
+        QVector3D(
+            BACKGROUND_COLOR[0], BACKGROUND_COLOR[1], BACKGROUND_COLOR[2]));
+
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    densityResolveShader_.release();
+    densityResolveVAO_.release();
+}
+
+void ParticleRenderer::bindInstanceData(int firstInstance)
+{
+    // gl 3.3 has no base instance for instanced draws, so chunks are drawn
+    // by offsetting the instance attributes instead
+
+    const size_t base =
+        sizeof(QuantizedParticle) * static_cast<size_t>(firstInstance);
+
+    glBindBuffer(GL_ARRAY_BUFFER, particleInstanceData_.getHandle());
+    glVertexAttribPointer(
+        2, 3, GL_UNSIGNED_SHORT, true,
+        sizeof(QuantizedParticle),
+        reinterpret_cast<void *>(base + offsetof(QuantizedParticle, offset)));
+    glVertexAttribPointer(
+        3, 1, GL_UNSIGNED_SHORT, true,
+        sizeof(QuantizedParticle),
+        reinterpret_cast<void *>(base + offsetof(QuantizedParticle, value)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void ParticleRenderer::paintGL()
 {
-    glClearColor(0, 0.3f, 0.3f, 0);
+    glClearColor(
+        BACKGROUND_COLOR[0], BACKGROUND_COLOR[1], BACKGROUND_COLOR[2], 0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     glDisable(GL_CULL_FACE);
@@ -310,45 +1005,370 @@ void ParticleRenderer::paintGL()
         eye, lookAt_, Vec3(0, 1, 0));
     const Mat4 projView = (proj * view).transpose();
 
-    particleVAO_.bind();
-    particleShader_.bind();
-
-    const QMatrix4x4 vp(&projView.data[0][0]);
-    particleShader_.setUniformValue(
-        particleShader_.uniformLocation("projView"), vp);
-    particleShader_.setUniformValue(
-        particleShader_.uniformLocation("eyePosition"),
-        QVector3D(eye.x, eye.y, eye.z));
-    particleShader_.setUniformValue(
-        particleShader_.uniformLocation("cameraDir"),
-        QVector3D(dir.x, dir.y, dir.z));
-
     const float diagLen = (boundingBox_.upper - boundingBox_.lower).length();
     const float centerDis = distance(
         0.5f * (boundingBox_.lower + boundingBox_.upper), eye);
 
-    particleShader_.setUniformValue(
-        particleShader_.uniformLocation("nearClipDistance"),
-        agz::math::lerp(
-            centerDis - 0.5f * diagLen,
-            centerDis + 0.5f * diagLen,
-            nearClipDistance_));
-
-    particleShader_.setUniformValue(
-        particleShader_.uniformLocation("farClipDistance"),
-        agz::math::lerp(
-            centerDis - 0.5f * diagLen,
-            centerDis + 0.5f * diagLen,
-            farClipDistance_));
-
-    glDrawArraysInstanced(
-        GL_TRIANGLES, 0, vertexCount_,
-        middlePressed_ || rightPressed_ || isWheelScrolling_ ?
-            (std::min)(renderedCount_, 100000) :
-            renderedCount_);
-    
-    particleShader_.release();
-    particleVAO_.release();
+    const float nearClipDistance = agz::math::lerp(
+        centerDis - 0.5f * diagLen,
+        centerDis + 0.5f * diagLen,
+        nearClipDistance_);
+    const float farClipDistance = agz::math::lerp(
+        centerDis - 0.5f * diagLen,
+        centerDis + 0.5f * diagLen,
+        farClipDistance_);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const float viewportHeight = static_cast<float>(viewport[3]);
+
+    // pixels per world unit at unit view depth for perspective cameras, or
+    // at any depth for orthographic ones
+    const float pixelScale = perspective_ ?
+        0.5f * viewportHeight / std::tan(0.5f * PERSPECTIVE_FOV_RAD) :
+        viewportHeight / (ORTHO_HEIGHT_OVER_DISTANCE * distance_);
+
+    const QMatrix4x4 vp(&projView.data[0][0]);
+
+    const auto bindShader = [&](QOpenGLShaderProgram &shader)
+    {
+        shader.bind();
+        shader.setUniformValue(shader.uniformLocation("projView"), vp);
+        shader.setUniformValue(
+            shader.uniformLocation("eyePosition"),
+            QVector3D(eye.x, eye.y, eye.z));
+        shader.setUniformValue(
+            shader.uniformLocation("cameraDir"),
+            QVector3D(dir.x, dir.y, dir.z));
+        shader.setUniformValue(
+            shader.uniformLocation("nearClipDistance"), nearClipDistance);
+        shader.setUniformValue(
+            shader.uniformLocation("farClipDistance"), farClipDistance);
+        shader.setUniformValue(shader.uniformLocation("chunkBounds"), 0);
+        shader.setUniformValue(shader.uniformLocation("colorMap"), 1);
+        shader.setUniformValue(shader.uniformLocation("chunkSize"), CHUNK_SIZE);
+    };
+
+    const auto bindPointShader = [&](QOpenGLShaderProgram &shader)
+    {
+        bindShader(shader);
+
+        // perspective projections stretch off-center spheres, hence the
+        // extra margin on point sizes
+        shader.setUniformValue(
+            shader.uniformLocation("invProjView"), vp.inverted());
+        shader.setUniformValue(
+            shader.uniformLocation("viewportSize"),
+            QVector2D(static_cast<float>(viewport[2]), viewportHeight));
+        shader.setUniformValue(
+            shader.uniformLocation("perspective"), perspective_);
+        shader.setUniformValue(
+            shader.uniformLocation("pointSizeScale"),
+            (perspective_ ? 2.4f : 2.0f) * pixelScale);
+    };
+
+    // particles are drawn chunk by chunk, each drawing the same fraction of
+    // its particles. far away, splat nodes stand in for their chunks:
+    // starting from the root, the node whose aggregation cells look largest
+    // on screen is refined into its children, or a leaf into its particles,
+    // until all cells are smaller than a few pixels or the next refinement
+    // would exceed the primitive budget of the frame. nodes outside the view
+    // frustum or the clipping slab are skipped, and adjacent draws are
+    // merged. density mode draws the particles of all visible chunks
+
+    const bool interacting =
+        middlePressed_ || rightPressed_ || isWheelScrolling_;
+    const int renderedCount = interacting ?
+        (std::min)(renderedCount_, 100000) : renderedCount_;
+    const double renderedRatio =
+        static_cast<double>(renderedCount) / instanceCount_;
+    const float maxSplatCellPixels =
+        interacting ? SPLAT_INTERACTIVE_PIXELS : SPLAT_IDLE_PIXELS;
+    const int primitiveBudget =
+        interacting ? INTERACTIVE_PRIMITIVE_BUDGET : IDLE_PRIMITIVE_BUDGET;
+
+    const Frustum frustum = perspective_ ?
+        Frustum::perspective(eye, dir, PERSPECTIVE_FOV_RAD, wOverH) :
+        Frustum::orthographic(
+            eye, dir, ORTHO_HEIGHT_OVER_DISTANCE * distance_, wOverH);
+
+    const auto getDrawnCount = [&](const ParticleChunk &chunk)
+    {
+        return static_cast<int>((chunk.first + chunk.count) * renderedRatio) -
+               static_cast<int>(chunk.first * renderedRatio);
+    };
+
+    // node bounds only cover particle centers and splat centers, which are
+    // also what the fragment shaders clip by. minDepth is the nearest view
+    // depth of a visible node
+    const auto isNodeCulled = [&](const SplatNode &node, float &minDepth)
+    {
+        const Vec3 center = 0.5f * (node.bound.lower + node.bound.upper);
+        const Vec3 extent = 0.5f * (node.bound.upper - node.bound.lower);
+        const float centerDepth = dot(center - eye, dir);
+        const float depthRadius = std::abs(dir.x) * extent.x
+                                + std::abs(dir.y) * extent.y
+                                + std::abs(dir.z) * extent.z;
+        minDepth = centerDepth - depthRadius;
+
+        const float margin = (std::max)(particleRadius_, node.maxSplatRadius);
+        return centerDepth + depthRadius < nearClipDistance ||
+               centerDepth - depthRadius > farClipDistance ||
+               frustum.isOutside(node.bound, margin);
+    };
+
+    std::vector<int> particleChunks, splatNodes;
+
+    if(densityMode_)
+    {
+        for(int i = 0; i < static_cast<int>(chunks_.size()); ++i)
+        {
+            float minDepth;
+            if(!isNodeCulled(splatNodes_[i], minDepth) &&
+               getDrawnCount(chunks_[i]) > 0)
+                particleChunks.push_back(i);
+        }
+    }
+    else
+    {
+        // a visible node not refined further is drawn by its splats, except
+        // for leaves having no more particles to draw than splats
+        struct Coarse
+        {
+            int   node;
+            int   cost;
+            float cellPixels;
+            bool  isParticles;
+        };
+
+        const auto getCoarse = [&](int nodeIndex, Coarse &coarse)
+        {
+            const SplatNode &node = splatNodes_[nodeIndex];
+
+            float minDepth;
+            if(isNodeCulled(node, minDepth))
+                return false;
+
+            coarse.node = nodeIndex;
+            coarse.cost = node.splatCount;
+            coarse.cellPixels = perspective_ ?
+                node.splatCellSize * pixelScale / (std::max)(minDepth, 1e-4f) :
+                node.splatCellSize * pixelScale;
+            coarse.isParticles = false;
+
+            if(node.children[0] < 0)
+            {
+                const int drawnCount = getDrawnCount(chunks_[node.firstChunk]);
+                if(drawnCount <= 0)
+                    return false;
+                if(drawnCount <= node.splatCount)
+                {
+                    coarse.cost = drawnCount;
+                    coarse.isParticles = true;
+                }
+            }
+
+            return true;
+        };
+
+        const auto compareCellPixels = [](const Coarse &a, const Coarse &b)
+        {
+            return a.cellPixels < b.cellPixels;
+        };
+        std::priority_queue<
+            Coarse, std::vector<Coarse>, decltype(compareCellPixels)>
+                candidates(compareCellPixels);
+
+        int primitiveCount = 0;
+        const auto select = [&](const Coarse &coarse)
+        {
+            primitiveCount += coarse.cost;
+            if(coarse.isParticles)
+                particleChunks.push_back(splatNodes_[coarse.node].firstChunk);
+            else
+                candidates.push(coarse);
+        };
+
+        Coarse root;
+        if(getCoarse(static_cast<int>(splatNodes_.size()) - 1, root))
+            select(root);
+
+        while(!candidates.empty())
+        {
+            const Coarse coarse = candidates.top();
+            if(coarse.cellPixels < maxSplatCellPixels)
+                break;
+            candidates.pop();
+
+            const SplatNode &node = splatNodes_[coarse.node];
+
+            Coarse refined[2];
+            int refinedCount = 0, refinedCost = 0;
+            if(node.children[0] < 0)
+            {
+                refined[0] = coarse;
+                refined[0].cost = getDrawnCount(chunks_[node.firstChunk]);
+                refined[0].isParticles = true;
+                refinedCount = 1;
+                refinedCost = refined[0].cost;
+            }
+            else
+            {
+                for(int child : node.children)
+                {
+                    if(child >= 0 && getCoarse(child, refined[refinedCount]))
+                        refinedCost += refined[refinedCount++].cost;
+                }
+            }
+
+            if(primitiveCount - coarse.cost + refinedCost > primitiveBudget)
+            {
+                splatNodes.push_back(coarse.node);
+                continue;
+            }
+
+            primitiveCount -= coarse.cost;
+            for(int i = 0; i < refinedCount; ++i)
+                select(refined[i]);
+        }
+
+        for(; !candidates.empty(); candidates.pop())
+            splatNodes.push_back(candidates.top().node);
+    }
+
+    // nodes and chunks are stored in the order of their splats and particles
+
+    std::sort(particleChunks.begin(), particleChunks.end());
+    std::sort(splatNodes.begin(), splatNodes.end());
+
+    std::vector<std::pair<int, int>> particleRuns, splatRuns;
+    const auto appendRun = [](
+        std::vector<std::pair<int, int>> &runs, int first, int count)
+    {
+        if(!runs.empty() && runs.back().first + runs.back().second == first)
+            runs.back().second += count;
+        else
+            runs.push_back({ first, count });
+    };
+
+    lastVisibleChunkCount_ = static_cast<int>(particleChunks.size());
+    lastSplatNodeCount_    = static_cast<int>(splatNodes.size());
+    lastDrawnCount_        = 0;
+
+    for(int chunkIndex : particleChunks)
+    {
+        const auto &chunk = chunks_[chunkIndex];
+        const int drawnCount = getDrawnCount(chunk);
+        lastDrawnCount_ += drawnCount;
+        appendRun(particleRuns, chunk.first, drawnCount);
+    }
+
+    for(int nodeIndex : splatNodes)
+    {
+        const auto &node = splatNodes_[nodeIndex];
+        lastDrawnCount_ += node.splatCount;
+        appendRun(splatRuns, node.splatFirst, node.splatCount);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, chunkBoundTexture_);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, colorMapTexture_);
+    glActiveTexture(GL_TEXTURE0);
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    // individual particles
+
+    if(densityMode_)
+    {
+        // particles are accumulated additively into a float target, which is
+        // then resolved into the widget framebuffer. weights are scaled so
+        // that drawing a subset keeps the overall density
+
+        prepareDensityTarget(viewport[2], viewport[3]);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, densityFramebuffer_);
+        glClearColor(0, 0, 0, 0);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+
+        impostorVAO_.bind();
+        bindPointShader(densityShader_);
+        densityShader_.setUniformValue(
+            densityShader_.uniformLocation("quantized"), true);
+        densityShader_.setUniformValue(
+            densityShader_.uniformLocation("weightScale"),
+            static_cast<float>(1 / renderedRatio));
+        glVertexAttrib1f(4, particleRadius_);
+
+        for(auto &[first, count] : particleRuns)
+            glDrawArrays(GL_POINTS, first, count);
+
+        densityShader_.release();
+        impostorVAO_.release();
+
+        glDisable(GL_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+
+        resolveDensity();
+    }
+    else if(useImpostors_)
+    {
+        impostorVAO_.bind();
+        bindPointShader(impostorShader_);
+        impostorShader_.setUniformValue(
+            impostorShader_.uniformLocation("quantized"), true);
+        glVertexAttrib1f(4, particleRadius_);
+
+        for(auto &[first, count] : particleRuns)
+            glDrawArrays(GL_POINTS, first, count);
+
+        impostorShader_.release();
+        impostorVAO_.release();
+    }
+    else
+    {
+        particleVAO_.bind();
+        bindShader(particleShader_);
+
+        const int firstInstanceLoc =
+            particleShader_.uniformLocation("firstInstance");
+        for(auto &[first, count] : particleRuns)
+        {
+            bindInstanceData(first);
+            particleShader_.setUniformValue(firstInstanceLoc, first);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount_, count);
+        }
+
+        particleShader_.release();
+        particleVAO_.release();
+    }
+
+    // aggregated splats
+
+    if(!splatRuns.empty())
+    {
+        splatVAO_.bind();
+        bindPointShader(impostorShader_);
+        impostorShader_.setUniformValue(
+            impostorShader_.uniformLocation("quantized"), false);
+
+        for(auto &[first, count] : splatRuns)
+            glDrawArrays(GL_POINTS, first, count);
+
+        impostorShader_.release();
+        splatVAO_.release();
+    }
+
+    glDisable(GL_PROGRAM_POINT_SIZE);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
 }
 
 void ParticleRenderer::mousePressEvent(QMouseEvent *event)
@@ -480,4 +1500,14 @@ void ParticleRenderer::paintEvent(QPaintEvent *event)
     painter.drawText(
         0, fm.height() + fm.height(),
         QString(" Number of rendered particles: %1").arg(renderedCount_));
+    painter.drawText(
+        0, 3 * fm.height(),
+        QString(" Number of drawn particles   : %1 (%2 / %3 chunks)")
+            .arg(lastDrawnCount_)
+            .arg(lastVisibleChunkCount_)
+            .arg(static_cast<int>(chunks_.size())));
+    painter.drawText(
+        0, 4 * fm.height(),
+        QString(" Number of splat nodes       : %1")
+            .arg(lastSplatNodeCount_));
 }
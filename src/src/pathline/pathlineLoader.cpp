@@ -1,11 +1,20 @@
-#include <map>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <iostream>
 
-#include <pugixml/pugixml.hpp>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
-#include <agz/utility/string.h>
+#include <pugixml/pugixml.hpp>
 
 #include <crius/pathline/pathlineLoader.h>
 #include <crius/utility/base64ToArray.h>
+#include <crius/utility/columnCache.h>
+#include <crius/utility/mappedFile.h>
+#include <crius/utility/parallelFor.h>
+#include <crius/utility/radixSort.h>
 
 namespace
 {
@@ -60,6 +69,8 @@ namespace
         pugi::xml_node x;
         pugi::xml_node y;
         pugi::xml_node z;
+
+        bool isIdDecimal = true;
     };
 
     pugi::xml_node findPathlineComponentData(pugi::xml_node section, int index)
@@ -87,98 +98,528 @@ namespace
         return ret;
     }
 
-    std::vector<int32_t> parseInt32Array(const char *str)
+    bool isSpaceChar(char c) noexcept
     {
-        std::vector<int32_t> ret;
-        auto int32Strs = agz::stdstr::split(agz::stdstr::trim(str), ' ', true);
-        for(auto &s : int32Strs)
-            ret.push_back(agz::stdstr::from_string<int32_t>(s));
-        return ret;
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    bool isDigitChar(char c) noexcept
+    {
+        return '0' <= c && c <= '9';
+    }
+
+    // id items are written either as decimal text or, like the float items,
+    // as base64 encoded little endian int32s
+
+    size_t int32Count(const char *str, bool *isDecimal)
+    {
+        // count token starts and detect non-decimal chars in one pass, using
+        // a lookup of char classes so that the loop is free of branches
+
+        constexpr uint8_t SPACE = 1, DECIMAL = 2;
+
+        static const auto CHAR_CLASSES = []
+        {
+            std::array<uint8_t, 256> ret = {};
+            for(int c = 0; c < 256; ++c)
+            {
+                if(isSpaceChar(static_cast<char>(c)))
+                    ret[c] = SPACE | DECIMAL;
+                else if(isDigitChar(static_cast<char>(c)) ||
+                        c == '-' || c == '+')
+                    ret[c] = DECIMAL;
+            }
+            return ret;
+        }();
+
+        size_t count = 0;
+        uint8_t lastClass = SPACE, allClasses = DECIMAL;
+        for(const char *c = str; *c; ++c)
+        {
+            const uint8_t cls = CHAR_CLASSES[static_cast<uint8_t>(*c)];
+            count += lastClass & ~cls & SPACE;
+            allClasses &= cls;
+            lastClass = cls;
+        }
+
+        *isDecimal = (allClasses & DECIMAL) != 0;
+        return *isDecimal ? count : base64Int32Count(str);
+    }
+
+    int countTrailingZeros(uint64_t x) noexcept
+    {
+        assert(x);
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(x);
+#endif
+    }
+
+    // 8 chars starting at str as a word whose lowest byte is str[0]
+    uint64_t loadWord(const char *str) noexcept
+    {
+        uint64_t word;
+        std::memcpy(&word, str, sizeof(word));
+        return agz::misc::to_local_endian<
+            agz::misc::endian_type::little>(word);
+    }
+
+    // number of leading decimal digits in a word. a byte is a digit iff its
+    // high nibble is 3 and its low nibble plus 6 does not reach 16, which can
+    // be tested for all bytes at once without carries between bytes
+    int leadingDigitCount(uint64_t word) noexcept
+    {
+        const uint64_t lowPlus6 =
+            (word & 0x0f0f0f0f0f0f0f0full) + 0x0606060606060606ull;
+        const uint64_t nonDigit =
+            ((word & 0xf0f0f0f0f0f0f0f0ull) ^ 0x3030303030303030ull) |
+            (lowPlus6 & 0xf0f0f0f0f0f0f0f0ull);
+        if(!nonDigit)
+            return 8;
+
+        // set the high bit of each non-zero byte
+        const uint64_t nonDigitBits =
+            (nonDigit | ((nonDigit & 0x7f7f7f7f7f7f7f7full) +
+                         0x7f7f7f7f7f7f7f7full)) & 0x8080808080808080ull;
+        return countTrailingZeros(nonDigitBits) / 8;
+    }
+
+    // value of the leading n (1 <= n <= 8) digits of a word. the digits are
+    // shifted to the top so that missing ones act as leading zeros, then
+    // adjacent lanes are combined pairwise in three multiplications
+    uint32_t parseDigits(uint64_t word, int n) noexcept
+    {
+        assert(1 <= n && n <= 8);
+        uint64_t d = (word & 0x0f0f0f0f0f0f0f0full) << (8 * (8 - n));
+        d = (d * 10    + (d >> 8))  & 0x00ff00ff00ff00ffull;
+        d = (d * 100   + (d >> 16)) & 0x0000ffff0000ffffull;
+        d = (d * 10000 + (d >> 32)) & 0x00000000ffffffffull;
+        return static_cast<uint32_t>(d);
+    }
+
+    /**
+     * @brief parse count whitespace separated decimal int32s into output
+     *
+     * digits are consumed 8 at a time while at least 8 chars remain. no
+     * memory is allocated.
+     */
+    void parseDecimalInt32Array(const char *str, int32_t *output, size_t count)
+    {
+        constexpr uint32_t POW10[9] = {
+            1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+        };
+
+        const char *cur = str;
+        const char *end = str + std::strlen(str);
+
+        for(size_t i = 0; i < count; ++i)
+        {
+            while(cur < end && isSpaceChar(*cur))
+                ++cur;
+            if(cur == end)
+                throw std::runtime_error("too few particle ids");
+
+            bool negative = false;
+            if(*cur == '-' || *cur == '+')
+                negative = *cur++ == '-';
+
+            int64_t value = 0;
+            int digitCount = 0;
+
+            while(end - cur >= 8 && digitCount <= 10)
+            {
+                const uint64_t word = loadWord(cur);
+                const int n = leadingDigitCount(word);
+                if(!n)
+                    break;
+
+                value = value * POW10[n] + parseDigits(word, n);
+                digitCount += n;
+                cur += n;
+
+                if(n < 8)
+                    break;
+            }
+
+            while(cur < end && isDigitChar(*cur) && digitCount <= 10)
+            {
+                value = value * 10 + (*cur++ - '0');
+                ++digitCount;
+            }
+
+            if(!digitCount || digitCount > 10 ||
+               (cur < end && !isSpaceChar(*cur)))
+                throw std::runtime_error("invalid particle id");
+
+            value = negative ? -value : value;
+            if(value < std::numeric_limits<int32_t>::min() ||
+               value > std::numeric_limits<int32_t>::max())
+                throw std::runtime_error("particle id out of int32 range");
+
+            output[i] = static_cast<int32_t>(value);
+        }
+    }
+
+    void parseInt32Array(
+        const char *str, bool isDecimal, int32_t *output, size_t count)
+    {
+        if(isDecimal)
+            parseDecimalInt32Array(str, output, count);
+        else
+            base64ToInt32Array(str, output, count);
+    }
+
+    // sort key of a timepoint: pathline id in the high 32 bits and time in
+    // the low 32 bits, both mapped to unsigned integers of the same order
+
+    uint64_t timepointSortKey(int32_t id, float time) noexcept
+    {
+        uint32_t timeBits;
+        std::memcpy(&timeBits, &time, sizeof(float));
+        timeBits = (timeBits & 0x80000000u) ?
+                   ~timeBits : (timeBits | 0x80000000u);
+
+        const uint32_t idBits = static_cast<uint32_t>(id) ^ 0x80000000u;
+
+        return (static_cast<uint64_t>(idBits) << 32) | timeBits;
+    }
+
+    // cache columns: pathline offsets of uint64 followed by time and
+    // normalized x, y, z of all timepoints, all of float32
+
+    constexpr uint32_t PATHLINE_CACHE_FORMAT = 0x50544C31; // 'PTL1'
+
+    struct PathlineCacheMetadata
+    {
+        uint64_t pathlineCount;
+        uint64_t timepointCount;
+        float    offset[3];
+        float    scale;
+        float    lower[3];
+        float    upper[3];
+    };
+
+    bool loadPathlineCache(
+        const std::string           &filename,
+        agz::thread::thread_group_t &threadGroup,
+        int                          threadCount,
+        PathlineSet                 &pathlines)
+    {
+        auto cache = ColumnCache::open(
+            filename, PATHLINE_CACHE_FORMAT, sizeof(PathlineCacheMetadata));
+        if(!cache || cache->getColumnCount() != 5)
+            return false;
+
+        PathlineCacheMetadata metadata;
+        std::memcpy(&metadata, cache->getMetadata(), sizeof(metadata));
+
+        if(metadata.timepointCount >
+           static_cast<uint64_t>(std::numeric_limits<int32_t>::max()))
+            return false;
+
+        size_t offsetCount;
+        const uint64_t *offsets = cache->getColumn<uint64_t>(0, &offsetCount);
+        if(!offsets || offsetCount != metadata.pathlineCount + 1 ||
+           offsets[0] != 0 ||
+           offsets[metadata.pathlineCount] != metadata.timepointCount)
+            return false;
+
+        const float *columns[4];
+        for(size_t i = 0; i < 4; ++i)
+        {
+            size_t count;
+            columns[i] = cache->getColumn<float>(i + 1, &count);
+            if(!columns[i] || count != metadata.timepointCount)
+                return false;
+        }
+
+        pathlines.offsets.resize(offsetCount);
+        for(size_t i = 0; i < offsetCount; ++i)
+        {
+            if(i > 0 && offsets[i] < offsets[i - 1])
+                return false;
+            pathlines.offsets[i] = static_cast<int32_t>(offsets[i]);
+        }
+
+        pathlines.positions.resize(metadata.timepointCount);
+        pathlines.times.resize(metadata.timepointCount);
+
+        parallelForBlocks(
+            threadGroup, threadCount, pathlines.positions.size(), 1 << 16,
+            [&](int, size_t beg, size_t end)
+        {
+            for(size_t i = beg; i < end; ++i)
+            {
+                pathlines.times[i]     = columns[0][i];
+                pathlines.positions[i] = {
+                    columns[1][i], columns[2][i], columns[3][i]
+                };
+            }
+        });
+
+        return true;
+    }
+
+    void savePathlineCache(
+        const std::string           &filename,
+        agz::thread::thread_group_t &threadGroup,
+        int                          threadCount,
+        const PathlineSet           &pathlines,
+        const Vec3                  &offset,
+        float                        scale)
+    {
+        const std::vector<uint64_t> offsets(
+            pathlines.offsets.begin(), pathlines.offsets.end());
+
+        std::vector<float> columns[3];
+        for(auto &c : columns)
+            c.resize(pathlines.positions.size());
+
+        std::vector<Vec3> threadL(
+            threadCount, Vec3(std::numeric_limits<float>::max()));
+        std::vector<Vec3> threadH(
+            threadCount, Vec3(std::numeric_limits<float>::lowest()));
+
+        parallelForBlocks(
+            threadGroup, threadCount, pathlines.positions.size(), 1 << 16,
+            [&](int threadIndex, size_t beg, size_t end)
+        {
+            Vec3 L = threadL[threadIndex], H = threadH[threadIndex];
+            for(size_t i = beg; i < end; ++i)
+            {
+                const Vec3 &p = pathlines.positions[i];
+                columns[0][i] = p.x;
+                columns[1][i] = p.y;
+                columns[2][i] = p.z;
+                L = elem_min(L, p);
+                H = elem_max(H, p);
+            }
+            threadL[threadIndex] = L;
+            threadH[threadIndex] = H;
+        });
+
+        Vec3 L(std::numeric_limits<float>::max());
+        Vec3 H(std::numeric_limits<float>::lowest());
+        for(int i = 0; i < threadCount; ++i)
+        {
+            L = elem_min(L, threadL[i]);
+            H = elem_max(H, threadH[i]);
+        }
+
+        PathlineCacheMetadata metadata = {};
+        metadata.pathlineCount  = pathlines.getPathlineCount();
+        metadata.timepointCount = pathlines.getTimepointCount();
+        metadata.scale          = scale;
+        for(int i = 0; i < 3; ++i)
+        {
+            metadata.offset[i] = offset[i];
+            metadata.lower[i]  = L[i];
+            metadata.upper[i]  = H[i];
+        }
+
+        std::vector<ColumnCache::Column> cacheColumns = {
+            { offsets.data(), offsets.size() * sizeof(uint64_t) },
+            { pathlines.times.data(), pathlines.times.size() * sizeof(float) }
+        };
+        for(auto &c : columns)
+            cacheColumns.push_back({ c.data(), c.size() * sizeof(float) });
+
+        if(!ColumnCache::write(
+            filename, PATHLINE_CACHE_FORMAT,
+            &metadata, sizeof(metadata), cacheColumns))
+        {
+            std::cerr << "failed to write pathline cache of "
+                      << filename << std::endl;
+        }
     }
 
 } // namespace anonymous
 
-void PathlineLoader::loadFromXML(const std::string &filename)
+void PathlineLoader::loadFromXML(
+    const std::string           &filename,
+    agz::thread::thread_group_t &threadGroup)
 {
-    allPathlines_.clear();
+    allPathlines_ = PathlineSet();
+
+    const int threadCount = agz::thread::actual_worker_count(-1);
+
+    if(loadPathlineCache(filename, threadGroup, threadCount, allPathlines_))
+        return;
+
+    // parse in place without escaping or eol normalization, so that only
+    // the pages holding string terminators are copied from the mapped file
+
+    MappedFile file(filename);
 
     pugi::xml_document doc;
-    if(!doc.load_file(filename.c_str()))
+    if(!doc.load_buffer_inplace(
+        file.data(), file.size(), pugi::parse_minimal, pugi::encoding_utf8))
         throw std::runtime_error("failed to load/parse xml file: " + filename);
 
     const auto indices = findPathlineIndices(doc);
 
-    std::map<int, Pathline> pathlines;
-
+    std::vector<PathlineXMLData> sections;
     for(auto section : doc.child("ParticleTracks").child("Tracks"))
     {
-        if(section.name() != std::string_view("Section"))
-            continue;
+        if(section.name() == std::string_view("Section"))
+            sections.push_back(findPathlineXMLData(section, indices));
+    }
+
+    // timepoint count of each section
 
-        auto xmlData  = findPathlineXMLData(section, indices);
-        auto idData   = parseInt32Array(xmlData.id.text().get());
-        auto timeData = base64ToFloatArray(xmlData.time.text().get());
-        auto xData    = base64ToFloatArray(xmlData.x.text().get());
-        auto yData    = base64ToFloatArray(xmlData.y.text().get());
-        auto zData    = base64ToFloatArray(xmlData.z.text().get());
+    std::vector<size_t> sectionOffsets(sections.size() + 1, 0);
 
-        if(idData.size() != xData.size() ||
-           idData.size() != yData.size() ||
-           idData.size() != zData.size() ||
-           idData.size() != timeData.size())
+    parallelForBlocks(
+        threadGroup, threadCount, sections.size(), 1,
+        [&](int, size_t i, size_t)
+    {
+        auto &xmlData = sections[i];
+        const size_t count = int32Count(
+            xmlData.id.text().get(), &xmlData.isIdDecimal);
+
+        if(count != base64FloatCount(xmlData.time.text().get()) ||
+           count != base64FloatCount(xmlData.x.text().get()) ||
+           count != base64FloatCount(xmlData.y.text().get()) ||
+           count != base64FloatCount(xmlData.z.text().get()))
             throw std::runtime_error("x/y/z/id/time data sizes are unmatched");
 
-        for(size_t i = 0; i < idData.size(); ++i)
+        sectionOffsets[i + 1] = count;
+    });
+
+    for(size_t i = 1; i < sectionOffsets.size(); ++i)
+        sectionOffsets[i] += sectionOffsets[i - 1];
+
+    const size_t timepointCount = sectionOffsets.back();
+    if(timepointCount >
+       static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+        throw std::runtime_error("too many timepoints in " + filename);
+
+    // decode sections into their own ranges of the flat arrays, together
+    // with the (id, time) sort keys
+
+    std::vector<uint64_t> sortKeys(timepointCount);
+    std::vector<float>    allTimes(timepointCount);
+    std::vector<Vec3>     allPositions(timepointCount);
+
+    std::vector<Vec3> threadL(
+        threadCount, Vec3(std::numeric_limits<float>::max()));
+    std::vector<Vec3> threadH(
+        threadCount, Vec3(std::numeric_limits<float>::lowest()));
+
+    std::vector<std::vector<int32_t>> threadIds(threadCount);
+
+    parallelForBlocks(
+        threadGroup, threadCount, sections.size(), 1,
+        [&](int threadIndex, size_t i, size_t)
+    {
+        auto &xmlData = sections[i];
+        const size_t offset = sectionOffsets[i];
+        const size_t count = sectionOffsets[i + 1] - offset;
+
+        // ids are only needed for the sort keys, so they go into a buffer
+        // reused by all sections of this thread
+
+        auto &idData = threadIds[threadIndex];
+        idData.resize(count);
+        parseInt32Array(
+            xmlData.id.text().get(), xmlData.isIdDecimal, idData.data(), count);
+
+        std::vector<float> xData(count), yData(count), zData(count);
+        base64ToFloatArray(
+            xmlData.time.text().get(), allTimes.data() + offset, count);
+        base64ToFloatArray(xmlData.x.text().get(), xData.data(), count);
+        base64ToFloatArray(xmlData.y.text().get(), yData.data(), count);
+        base64ToFloatArray(xmlData.z.text().get(), zData.data(), count);
+
+        Vec3 L = threadL[threadIndex], H = threadH[threadIndex];
+        for(size_t j = 0; j < count; ++j)
         {
-            pathlines[idData[i]].points.push_back({
-                timeData[i], { xData[i], yData[i], zData[i] }
-            });
+            const Vec3 position(xData[j], yData[j], zData[j]);
+            allPositions[offset + j] = position;
+            sortKeys[offset + j] = timepointSortKey(
+                idData[j], allTimes[offset + j]);
+
+            L = elem_min(L, position);
+            H = elem_max(H, position);
         }
-    }
+        threadL[threadIndex] = L;
+        threadH[threadIndex] = H;
+    });
 
     Vec3 L(std::numeric_limits<float>::max());
     Vec3 H(std::numeric_limits<float>::lowest());
-    for(auto &p : pathlines)
+    for(int i = 0; i < threadCount; ++i)
     {
-        for(auto &tp : p.second.points)
-        {
-            L = elem_min(L, tp.position);
-            H = elem_max(H, tp.position);
-        }
+        L = elem_min(L, threadL[i]);
+        H = elem_max(H, threadH[i]);
     }
 
     const Vec3 offset = -0.5f * (L + H);
     const float scale = 1 / (std::max)((H - L).max_elem(), 0.001f);
 
-    size_t maxLen = 0;
+    // sort timepoints by (id, time)
 
-    for(auto &p : pathlines)
+    std::vector<uint32_t> order(timepointCount);
+    parallelForBlocks(
+        threadGroup, threadCount, timepointCount, 1 << 16,
+        [&](int, size_t beg, size_t end)
     {
-        for(auto &tp : p.second.points)
-            tp.position = scale * (tp.position + offset);
+        for(size_t i = beg; i < end; ++i)
+            order[i] = static_cast<uint32_t>(i);
+    });
 
-        std::sort(
-            p.second.points.begin(), p.second.points.end(),
-            [](const Timepoint &L, const Timepoint &R)
-        {
-            return L.time < R.time;
-        });
+    parallelRadixSort(sortKeys, order, threadGroup, threadCount);
 
-        maxLen = std::max(maxLen, p.second.points.size());
-        allPathlines_.push_back({ std::move(p.second.points) });
-    }
+    // gather sorted & normalized timepoints, and find the first timepoint of
+    // each pathline
+
+    constexpr size_t GATHER_BLOCK_SIZE = 1 << 16;
+    const size_t blockCount =
+        (timepointCount + GATHER_BLOCK_SIZE - 1) / GATHER_BLOCK_SIZE;
+    std::vector<std::vector<int32_t>> blockPathlineStarts(blockCount);
+
+    allPathlines_.positions.resize(timepointCount);
+    allPathlines_.times.resize(timepointCount);
 
-    for(auto &p : allPathlines_)
+    parallelForBlocks(
+        threadGroup, threadCount, timepointCount, GATHER_BLOCK_SIZE,
+        [&](int, size_t beg, size_t end)
     {
-        if(p.points.size() < maxLen)
+        auto &starts = blockPathlineStarts[beg / GATHER_BLOCK_SIZE];
+        for(size_t i = beg; i < end; ++i)
         {
-            const auto newVal = p.points.back();
-            p.points.resize(maxLen, newVal);
+            const uint32_t src = order[i];
+            allPathlines_.positions[i] = scale * (allPositions[src] + offset);
+            allPathlines_.times[i]     = allTimes[src];
+
+            if(i > 0 && (sortKeys[i] >> 32) != (sortKeys[i - 1] >> 32))
+                starts.push_back(static_cast<int32_t>(i));
         }
+    });
+
+    allPathlines_.offsets.clear();
+    if(timepointCount)
+        allPathlines_.offsets.push_back(0);
+    for(auto &starts : blockPathlineStarts)
+    {
+        allPathlines_.offsets.insert(
+            allPathlines_.offsets.end(), starts.begin(), starts.end());
     }
+    allPathlines_.offsets.push_back(static_cast<int32_t>(timepointCount));
+
+    savePathlineCache(
+        filename, threadGroup, threadCount, allPathlines_, offset, scale);
+}
+
+const PathlineSet &PathlineLoader::getAllPathlines() const noexcept
+{
+    return allPathlines_;
 }
 
-const std::vector<PathlineLoader::Pathline> &PathlineLoader::getAllPathlines() const noexcept
+PathlineSet &PathlineLoader::getAllPathlines() noexcept
 {
     return allPathlines_;
 }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <random>
 
@@ -6,6 +7,7 @@
 #include <QPainter>
 
 #include <crius/pathline/pathlineRenderer.h>
+#include <crius/pathline/pathlineSimplifier.h>
 
 namespace
 {
@@ -14,15 +16,19 @@ namespace
     #version 330 core
 
     uniform mat4 projView;
+    uniform samplerBuffer pathlineColors;
 
     in vec3 position;
-    in vec3 color;
+    in uint pathlineIndex;
+    in float time;
 
     out vec3 o_color;
+    out float o_time;
 
     void main()
     {
-        o_color = color;
+        o_color = texelFetch(pathlineColors, int(pathlineIndex)).rgb;
+        o_time = time;
         gl_Position = projView * vec4(position, 1);
     }
     )___";
@@ -30,13 +36,29 @@ namespace
     const char PATHLINE_FS[] = R"___(
     #version 330 core
 
+    uniform bool animated;
+    uniform float currentTime;
+    uniform float tailLength;
+
     in vec3 o_color;
+    in float o_time;
 
     out vec4 fragColor;
 
     void main()
     {
-        fragColor = vec4(o_color, 1);
+        // when animated, only the tail of length tailLength behind the
+        // current time is drawn, fading out towards its older end
+
+        float alpha = 1;
+        if(animated)
+        {
+            float age = currentTime - o_time;
+            if(age < 0 || age > tailLength)
+                discard;
+            alpha = 1 - age / max(tailLength, 1e-20);
+        }
+        fragColor = vec4(o_color, alpha);
     }
     )___";
 
@@ -44,12 +66,33 @@ namespace
 
     constexpr float ORTHO_HEIGHT_OVER_DISTANCE = 0.72794f;
 
+    // simplification tolerances of levels of detail, relative to the largest
+    // extent of the normalized pathline bounding box
+
+    constexpr float LOD_TOLERANCES[] = { 0.001f, 0.004f, 0.016f };
+
+    // allowed screen-space error of the selected level of detail, in pixels
+
+    constexpr float LOD_PIXEL_ERROR_IDLE        = 0.75f;
+    constexpr float LOD_PIXEL_ERROR_INTERACTING = 4.0f;
+
+    void appendPathlineSet(PathlineSet &dst, const PathlineSet &src)
+    {
+        const int32_t base = dst.offsets.back();
+        dst.positions.insert(
+            dst.positions.end(), src.positions.begin(), src.positions.end());
+        dst.times.insert(dst.times.end(), src.times.begin(), src.times.end());
+        for(int i = 1; i <= src.getPathlineCount(); ++i)
+            dst.offsets.push_back(base + src.offsets[i]);
+    }
+
 } // namespace anonymous
 
 PathlineRenderer::PathlineRenderer(
-    QWidget              *parent,
-    std::vector<Pathline> pathlines)
-    : QOpenGLWidget(parent), pathlines_(std::move(pathlines))
+    QWidget                     *parent,
+    PathlineSet                  pathlines,
+    agz::thread::thread_group_t &threadGroup)
+    : QOpenGLWidget(parent)
 {
     // gl core profile version
 
@@ -68,9 +111,52 @@ PathlineRenderer::PathlineRenderer(
     boundingBox_ = { Vec3(0), Vec3(1) };
     useDefaultCamera();
 
-    vertexCount_         = 0;
-    vertexPerPathline_   = 0;
-    renderedVertexCount_ = 0;
+    pathlineCount_         = pathlines.getPathlineCount();
+    renderedPathlineCount_ = pathlineCount_;
+
+    // time range
+
+    if(!pathlines.times.empty())
+    {
+        const auto [minTime, maxTime] = std::minmax_element(
+            pathlines.times.begin(), pathlines.times.end());
+        minTime_ = *minTime;
+        maxTime_ = *maxTime;
+    }
+    currentTime_ = maxTime_;
+    tailLength_  = maxTime_ - minTime_;
+
+    // levels of detail. every level is simplified from the original
+    // pathlines, so its deviation is bounded by its own tolerance. a level
+    // is only kept when it is notably smaller than the previous one
+
+    levels_.resize(1);
+    levels_[0].pathlines = std::move(pathlines);
+
+    for(float tolerance : LOD_TOLERANCES)
+    {
+        auto simplified = simplifyPathlines(
+            levels_[0].pathlines, tolerance, threadGroup);
+        if(simplified.getTimepointCount() >
+           0.8f * levels_.back().pathlines.getTimepointCount())
+            continue;
+
+        levels_.push_back({ tolerance, std::move(simplified) });
+    }
+
+    // wheel scrolling is considered finished after a short time
+
+    wheelTimer_ = new QTimer(this);
+    wheelTimer_->setSingleShot(true);
+    connect(wheelTimer_, &QTimer::timeout,
+        [&]
+    {
+        if(isWheelScrolling_)
+        {
+            isWheelScrolling_ = false;
+            update();
+        }
+    });
 }
 
 PathlineRenderer::~PathlineRenderer()
@@ -80,6 +166,10 @@ PathlineRenderer::~PathlineRenderer()
     vertices_.destroy();
     vao_.destroy();
 
+    if(colorTexture_)
+        glDeleteTextures(1, &colorTexture_);
+    colorBuffer_.destroy();
+
     doneCurrent();
 }
 
@@ -108,10 +198,10 @@ void PathlineRenderer::initializeGL()
         QOpenGLShader::Vertex, PATHLINE_VS);
     pathlineShader_.addShaderFromSourceCode(
         QOpenGLShader::Fragment, PATHLINE_FS);
-    pathlineShader_.link();
-
     pathlineShader_.bindAttributeLocation("position", 0);
-    pathlineShader_.bindAttributeLocation("color", 1);
+    pathlineShader_.bindAttributeLocation("pathlineIndex", 1);
+    pathlineShader_.bindAttributeLocation("time", 2);
+    pathlineShader_.link();
 
     glDisable(GL_CULL_FACE);
     glEnable(GL_DEPTH_TEST);
@@ -120,6 +210,130 @@ void PathlineRenderer::initializeGL()
     setPathlines();
 }
 
+void PathlineRenderer::appendPathlines(
+    const PathlineSet           &pathlines,
+    agz::thread::thread_group_t &threadGroup)
+{
+    const int appendedCount = pathlines.getPathlineCount();
+    if(!appendedCount)
+        return;
+
+    if(!pathlines.times.empty())
+    {
+        const auto [minTime, maxTime] = std::minmax_element(
+            pathlines.times.begin(), pathlines.times.end());
+        minTime_ = pathlineCount_ ? (std::min)(minTime_, *minTime) : *minTime;
+        maxTime_ = pathlineCount_ ? (std::max)(maxTime_, *maxTime) : *maxTime;
+        if(!animated_)
+            currentTime_ = maxTime_;
+    }
+
+    const bool renderAll = renderedPathlineCount_ == pathlineCount_;
+
+    // before initializeGL, appended pathlines are uploaded together with
+    // the initial ones
+
+    if(!vertices_.isCreated())
+    {
+        appendPathlineSet(levels_[0].pathlines, pathlines);
+        for(size_t i = 1; i < levels_.size(); ++i)
+        {
+            appendPathlineSet(
+                levels_[i].pathlines,
+                simplifyPathlines(pathlines, levels_[i].tolerance, threadGroup));
+        }
+    }
+    else
+    {
+        makeCurrent();
+
+        std::vector<Vertex> vertexData;
+        for(size_t l = 0; l < levels_.size(); ++l)
+        {
+            auto &level = levels_[l];
+            const PathlineSet simplified = l ?
+                simplifyPathlines(pathlines, level.tolerance, threadGroup) :
+                PathlineSet();
+            const PathlineSet &levelPathlines = l ? simplified : pathlines;
+
+            GLint first = static_cast<GLint>(vertices_.getSize() / sizeof(Vertex));
+            vertexData.clear();
+            for(int i = 0; i < appendedCount; ++i)
+            {
+                const int beg = levelPathlines.offsets[i];
+                const int end = levelPathlines.offsets[i + 1];
+                level.stripFirsts.push_back(first);
+                level.stripCounts.push_back(end - beg);
+                first += end - beg;
+
+                for(int j = beg; j < end; ++j)
+                {
+                    vertexData.push_back({
+                        agz::math::vec3f(levelPathlines.positions[j]),
+                        static_cast<uint32_t>(pathlineCount_ + i),
+                        levelPathlines.times[j] });
+                }
+            }
+
+            vertices_.append(
+                vertexData.data(), sizeof(Vertex) * vertexData.size());
+        }
+
+        std::default_random_engine rng{ std::random_device()() };
+        std::uniform_real_distribution<float> hueDis(0, 1);
+
+        std::vector<uint8_t> colorData(4 * appendedCount);
+        for(int i = 0; i < appendedCount; ++i)
+        {
+            const QColor qcolor = QColor::fromHsvF(hueDis(rng), 1, 1);
+            colorData[4 * i]     = static_cast<uint8_t>(qcolor.red());
+            colorData[4 * i + 1] = static_cast<uint8_t>(qcolor.green());
+            colorData[4 * i + 2] = static_cast<uint8_t>(qcolor.blue());
+            colorData[4 * i + 3] = 255;
+        }
+        colorBuffer_.append(colorData.data(), colorData.size());
+
+        doneCurrent();
+    }
+
+    pathlineCount_ += appendedCount;
+    if(renderAll)
+        renderedPathlineCount_ = pathlineCount_;
+
+    update();
+}
+
+void PathlineRenderer::clearPathlines()
+{
+    pathlineCount_         = 0;
+    renderedPathlineCount_ = 0;
+    minTime_               = 0;
+    maxTime_               = 0;
+
+    for(auto &level : levels_)
+    {
+        level.pathlines = PathlineSet();
+        level.stripFirsts.clear();
+        level.stripCounts.clear();
+    }
+
+    if(vertices_.isCreated())
+    {
+        makeCurrent();
+        vertices_.setData(nullptr, 0);
+        colorBuffer_.setData(nullptr, 0);
+        doneCurrent();
+    }
+
+    update();
+}
+
+void PathlineRenderer::setBoundingBox(const AABB &bbox)
+{
+    boundingBox_ = bbox;
+    useDefaultCamera();
+}
+
 void PathlineRenderer::useDefaultCamera()
 {
     horiRad_ = 0;
@@ -137,66 +351,150 @@ void PathlineRenderer::usePerspectiveCamera(bool perspective)
 
 void PathlineRenderer::setRenderedCount(int renderedCount)
 {
-    renderedVertexCount_ = renderedCount * vertexPerPathline_;
+    renderedPathlineCount_ = agz::math::clamp(
+        renderedCount, 0, pathlineCount_);
+    update();
+}
+
+float PathlineRenderer::getMinTime() const noexcept
+{
+    return minTime_;
+}
+
+float PathlineRenderer::getMaxTime() const noexcept
+{
+    return maxTime_;
+}
+
+void PathlineRenderer::setAnimated(bool animated)
+{
+    animated_ = animated;
     update();
 }
 
+void PathlineRenderer::setCurrentTime(float time)
+{
+    currentTime_ = time;
+    update();
+}
+
+void PathlineRenderer::setTailLength(float length)
+{
+    tailLength_ = (std::max)(length, 0.0f);
+    update();
+}
+
+float PathlineRenderer::getPixelToWorldScale() const noexcept
+{
+    // size of a pixel at the look-at point
+    if(perspective_)
+        return distance_ * 2 * std::tan(PERSPECTIVE_FOV_RAD / 2) / height();
+    return distance_ * ORTHO_HEIGHT_OVER_DISTANCE / height();
+}
+
+int PathlineRenderer::selectLevel(float pixelToWorldScale) const noexcept
+{
+    const bool interacting =
+        middlePressed_ || rightPressed_ || isWheelScrolling_;
+    const float maxError = pixelToWorldScale * (interacting ?
+        LOD_PIXEL_ERROR_INTERACTING : LOD_PIXEL_ERROR_IDLE);
+
+    int ret = 0;
+    while(ret + 1 < static_cast<int>(levels_.size()) &&
+          levels_[ret + 1].tolerance <= maxError)
+        ++ret;
+    return ret;
+}
+
 void PathlineRenderer::setPathlines()
 {
-    // bounding box
+    // bounding box, which is left unchanged when there is no pathline yet
 
-    boundingBox_.lower = Vec3(std::numeric_limits<float>::max());
-    boundingBox_.upper = Vec3(std::numeric_limits<float>::lowest());
-    for(auto &p : pathlines_)
+    if(!levels_[0].pathlines.positions.empty())
     {
-        for(auto &pn : p.points)
+        boundingBox_.lower = Vec3(std::numeric_limits<float>::max());
+        boundingBox_.upper = Vec3(std::numeric_limits<float>::lowest());
+        for(auto &pn : levels_[0].pathlines.positions)
         {
             boundingBox_.lower = elem_min(boundingBox_.lower, pn);
             boundingBox_.upper = elem_max(boundingBox_.upper, pn);
         }
     }
 
-    // vertex data
-
-    vertexPerPathline_   = 2 * static_cast<int>(pathlines_[0].points.size() - 1);
-    vertexCount_         = static_cast<int>(pathlines_.size() * vertexPerPathline_);
-    renderedVertexCount_ = vertexCount_;
+    // pathlines are visited in random order so that the first n pathlines
+    // form a random subset
 
-    std::vector<Vertex> vertexData;
-    vertexData.reserve(vertexCount_);
+    std::vector<int> pathlineOrder(pathlineCount_);
+    for(int i = 0; i < pathlineCount_; ++i)
+        pathlineOrder[i] = i;
 
     std::default_random_engine rng{ std::random_device()() };
-    const std::uniform_real_distribution<float> hueDis(0, 1);
-    std::shuffle(pathlines_.begin(), pathlines_.end(), rng);
+    std::uniform_real_distribution<float> hueDis(0, 1);
+    std::shuffle(pathlineOrder.begin(), pathlineOrder.end(), rng);
+
+    // strips of all levels share one vertex buffer
 
-    for(auto &pathline : pathlines_)
+    GLint first = 0;
+    for(auto &level : levels_)
     {
-        const float hue = hueDis(rng);
-        const QColor qcolor = QColor::fromHsvF(hue, 1, 1);
-        const agz::math::color3f color = {
-            static_cast<float>(qcolor.redF()),
-            static_cast<float>(qcolor.greenF()),
-            static_cast<float>(qcolor.blueF())
-        };
+        level.stripFirsts.resize(pathlineCount_);
+        level.stripCounts.resize(pathlineCount_);
+        for(int i = 0; i < pathlineCount_; ++i)
+        {
+            const int p = pathlineOrder[i];
+            level.stripFirsts[i] = first;
+            level.stripCounts[i] =
+                level.pathlines.offsets[p + 1] - level.pathlines.offsets[p];
+            first += level.stripCounts[i];
+        }
+    }
 
-        for(size_t i = 1; i < pathline.points.size(); ++i)
+    // vertex data
+
+    std::vector<Vertex> vertexData;
+    vertexData.reserve(first);
+
+    for(auto &level : levels_)
+    {
+        const auto &pathlines = level.pathlines;
+        for(int i = 0; i < pathlineCount_; ++i)
         {
-            vertexData.push_back(
-                { agz::math::vec3f(pathline.points[i - 1]), color });
-            vertexData.push_back(
-                { agz::math::vec3f(pathline.points[i]), color });
+            const int p = pathlineOrder[i];
+            for(int j = pathlines.offsets[p]; j < pathlines.offsets[p + 1]; ++j)
+            {
+                vertexData.push_back({
+                    agz::math::vec3f(pathlines.positions[j]),
+                    static_cast<uint32_t>(i),
+                    pathlines.times[j] });
+            }
         }
     }
 
-    assert(static_cast<int>(vertexData.size()) == vertexCount_);
+    if(!vertices_.isCreated())
+        vertices_.create(this);
+    vertices_.setData(vertexData.data(), sizeof(Vertex) * vertexData.size());
 
-    vertices_.destroy();
-    vertices_.create();
-    vertices_.bind();
-    vertices_.allocate(
-        vertexData.data(),
-        static_cast<int>(sizeof(Vertex) * vertexData.size()));
-    vertices_.release();
+    // pathline colors
+
+    std::vector<uint8_t> colorData(4 * pathlineCount_);
+    for(int i = 0; i < pathlineCount_; ++i)
+    {
+        const QColor qcolor = QColor::fromHsvF(hueDis(rng), 1, 1);
+        colorData[4 * i]     = static_cast<uint8_t>(qcolor.red());
+        colorData[4 * i + 1] = static_cast<uint8_t>(qcolor.green());
+        colorData[4 * i + 2] = static_cast<uint8_t>(qcolor.blue());
+        colorData[4 * i + 3] = 255;
+    }
+
+    if(!colorBuffer_.isCreated())
+        colorBuffer_.create(this);
+    colorBuffer_.setData(colorData.data(), colorData.size());
+
+    if(!colorTexture_)
+        glGenTextures(1, &colorTexture_);
+    glBindTexture(GL_TEXTURE_BUFFER, colorTexture_);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA8, colorBuffer_.getHandle());
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
 
     // vao
 
@@ -204,22 +502,28 @@ void PathlineRenderer::setPathlines()
     vao_.create();
     vao_.bind();
 
-    vertices_.bind();
+    glBindBuffer(GL_ARRAY_BUFFER, vertices_.getHandle());
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(
         0, 3, GL_FLOAT, false,
         sizeof(Vertex),
         reinterpret_cast<void *>(offsetof(Vertex, position)));
     glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(
+        1, 1, GL_UNSIGNED_INT,
+        sizeof(Vertex),
+        reinterpret_cast<void *>(offsetof(Vertex, pathlineIndex)));
+    glEnableVertexAttribArray(2);
     glVertexAttribPointer(
-        1, 3, GL_FLOAT, false,
+        2, 1, GL_FLOAT, false,
         sizeof(Vertex),
-        reinterpret_cast<void *>(offsetof(Vertex, color)));
-    vertices_.release();
+        reinterpret_cast<void *>(offsetof(Vertex, time)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     vao_.release();
 
-    pathlines_.clear();
+    for(auto &level : levels_)
+        level.pathlines = PathlineSet();
     useDefaultCamera();
 }
 
@@ -228,7 +532,7 @@ void PathlineRenderer::paintGL()
     glClearColor(0, 0.3f, 0.3f, 0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    if(renderedVertexCount_ <= 0)
+    if(renderedPathlineCount_ <= 0 || levels_[0].stripFirsts.empty())
         return;
     
     const float wOverH = static_cast<float>(width()) / height();
@@ -259,7 +563,41 @@ void PathlineRenderer::paintGL()
     pathlineShader_.setUniformValue(
         pathlineShader_.uniformLocation("projView"), vp);
 
-    glDrawArrays(GL_LINES, 0, renderedVertexCount_);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, colorTexture_);
+    pathlineShader_.setUniformValue(
+        pathlineShader_.uniformLocation("pathlineColors"), 0);
+
+    pathlineShader_.setUniformValue(
+        pathlineShader_.uniformLocation("animated"), animated_);
+    pathlineShader_.setUniformValue(
+        pathlineShader_.uniformLocation("currentTime"), currentTime_);
+    pathlineShader_.setUniformValue(
+        pathlineShader_.uniformLocation("tailLength"), tailLength_);
+
+    // fading tails are blended without writing depth so that they never
+    // hide lines drawn after them
+
+    if(animated_)
+    {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+    }
+
+    lastRenderedLevel_ = selectLevel(getPixelToWorldScale());
+    const auto &level = levels_[lastRenderedLevel_];
+    glMultiDrawArrays(
+        GL_LINE_STRIP, level.stripFirsts.data(), level.stripCounts.data(),
+        renderedPathlineCount_);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    if(animated_)
+    {
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
+    }
 
     pathlineShader_.release();
     vao_.release();
@@ -318,21 +656,12 @@ void PathlineRenderer::mouseMoveEvent(QMouseEvent *event)
     }
     else if(middlePressed_)
     {
-        const int H = height();
-
         const int dx = event->x() - lastMiddlePressX_;
         const int dy = event->y() - lastMiddlePressY_;
         lastMiddlePressX_ = event->x();
         lastMiddlePressY_ = event->y();
 
-        float pixelToWorldScale;
-        if(perspective_)
-        {
-            pixelToWorldScale =
-                distance_ * 2 * std::tan(PERSPECTIVE_FOV_RAD / 2) / H;
-        }
-        else
-            pixelToWorldScale = distance_ * ORTHO_HEIGHT_OVER_DISTANCE / H;
+        const float pixelToWorldScale = getPixelToWorldScale();
 
         const float worldX = dx * pixelToWorldScale;
         const float worldY = dy * pixelToWorldScale;
@@ -375,6 +704,8 @@ void PathlineRenderer::wheelEvent(QWheelEvent *event)
     distance_ = (std::max)(
         distance_, 0.2f * distance(boundingBox_.upper, boundingBox_.lower));
 
+    isWheelScrolling_ = true;
+    wheelTimer_->start(200);
     update();
 }
 
@@ -386,16 +717,29 @@ void PathlineRenderer::paintEvent(QPaintEvent *event)
     painter.setPen(Qt::white);
     QFontMetrics fm(painter.font());
 
-    if(vertexPerPathline_ > 0)
+    if(pathlineCount_ > 0)
     {
         painter.drawText(
             0, fm.height(),
             QString(" Number of pathlines          : %1").arg(
-                vertexCount_ / vertexPerPathline_));
+                pathlineCount_));
 
         painter.drawText(
             0, fm.height() + fm.height(),
             QString(" Number of rendered pathlines : %1").arg(
-                renderedVertexCount_ / vertexPerPathline_));
+                renderedPathlineCount_));
+
+        painter.drawText(
+            0, 3 * fm.height(),
+            QString(" Level of detail              : %1 / %2").arg(
+                lastRenderedLevel_).arg(static_cast<int>(levels_.size()) - 1));
+
+        if(animated_)
+        {
+            painter.drawText(
+                0, 4 * fm.height(),
+                QString(" Current time                 : %1").arg(
+                    currentTime_));
+        }
     }
 }
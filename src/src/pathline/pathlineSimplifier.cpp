@@ -0,0 +1,136 @@
+#include <crius/pathline/pathlineSimplifier.h>
+#include <crius/utility/parallelFor.h>
+
+namespace
+{
+
+    float squaredDistanceToSegment(
+        const Vec3 &p, const Vec3 &a, const Vec3 &b) noexcept
+    {
+        const Vec3 ab = b - a;
+        const float abLen2 = dot(ab, ab);
+        const float t = abLen2 > 0 ?
+            agz::math::saturate(dot(p - a, ab) / abLen2) : 0.0f;
+        const Vec3 d = p - (a + t * ab);
+        return dot(d, d);
+    }
+
+    // mark kept points of [beg, end) in keep, returns number of kept points
+    int simplifyPathline(
+        const Vec3         *points,
+        int                 beg,
+        int                 end,
+        float               tolerance2,
+        uint8_t            *keep,
+        std::vector<std::pair<int, int>> &stack)
+    {
+        if(end - beg <= 2)
+        {
+            std::fill(keep + beg, keep + end, 1);
+            return end - beg;
+        }
+
+        std::fill(keep + beg, keep + end, 0);
+        keep[beg] = keep[end - 1] = 1;
+        int keptCount = 2;
+
+        // explicit stack of [first, last] ranges instead of recursion, since
+        // long pathlines may have millions of points
+
+        stack.clear();
+        stack.push_back({ beg, end - 1 });
+        while(!stack.empty())
+        {
+            const auto [first, last] = stack.back();
+            stack.pop_back();
+
+            float maxDist2 = -1;
+            int farthest = -1;
+            for(int i = first + 1; i < last; ++i)
+            {
+                const float dist2 = squaredDistanceToSegment(
+                    points[i], points[first], points[last]);
+                if(dist2 > maxDist2)
+                {
+                    maxDist2 = dist2;
+                    farthest = i;
+                }
+            }
+
+            if(farthest < 0 || maxDist2 <= tolerance2)
+                continue;
+
+            keep[farthest] = 1;
+            ++keptCount;
+            stack.push_back({ first, farthest });
+            stack.push_back({ farthest, last });
+        }
+
+        return keptCount;
+    }
+
+} // namespace anonymous
+
+PathlineSet simplifyPathlines(
+    const PathlineSet           &pathlines,
+    float                        tolerance,
+    agz::thread::thread_group_t &threadGroup)
+{
+    const int pathlineCount  = pathlines.getPathlineCount();
+    const int timepointCount = pathlines.getTimepointCount();
+    const int threadCount    = agz::thread::actual_worker_count(-1);
+    const float tolerance2   = tolerance * tolerance;
+
+    constexpr size_t BLOCK_SIZE = 256;
+
+    // mark kept timepoints and count them for each pathline
+
+    std::vector<uint8_t> keep(timepointCount);
+    std::vector<int32_t> keptCounts(pathlineCount);
+    std::vector<std::vector<std::pair<int, int>>> threadStacks(threadCount);
+
+    parallelForBlocks(
+        threadGroup, threadCount, pathlineCount, BLOCK_SIZE,
+        [&](int threadIndex, size_t beg, size_t end)
+    {
+        for(size_t i = beg; i < end; ++i)
+        {
+            keptCounts[i] = simplifyPathline(
+                pathlines.positions.data(),
+                pathlines.offsets[i], pathlines.offsets[i + 1],
+                tolerance2, keep.data(), threadStacks[threadIndex]);
+        }
+    });
+
+    PathlineSet ret;
+    ret.offsets.resize(pathlineCount + 1);
+    ret.offsets[0] = 0;
+    for(int i = 0; i < pathlineCount; ++i)
+        ret.offsets[i + 1] = ret.offsets[i] + keptCounts[i];
+
+    // gather kept timepoints
+
+    ret.positions.resize(ret.offsets.back());
+    ret.times.resize(ret.offsets.back());
+
+    parallelForBlocks(
+        threadGroup, threadCount, pathlineCount, BLOCK_SIZE,
+        [&](int, size_t beg, size_t end)
+    {
+        for(size_t i = beg; i < end; ++i)
+        {
+            int dst = ret.offsets[i];
+            for(int j = pathlines.offsets[i]; j < pathlines.offsets[i + 1]; ++j)
+            {
+                if(keep[j])
+                {
+                    ret.positions[dst] = pathlines.positions[j];
+                    ret.times[dst]     = pathlines.times[j];
+                    ++dst;
+                }
+            }
+        }
+    });
+
+    return ret;
+}
@@ -6,8 +6,9 @@
 #include <crius/pathline/pathlineVisualizer.h>
 
 PathlineVisualizer::PathlineVisualizer(
-    QWidget           *parent,
-    const std::string &particleXMLFilename)
+    QWidget                        *parent,
+    const std::string              &particleXMLFilename,
+    RC<agz::thread::thread_group_t> threadGroup)
     : QWidget(parent)
 {
     auto layout     = new QVBoxLayout(this);
@@ -23,20 +24,13 @@ PathlineVisualizer::PathlineVisualizer(
     layout->addWidget(downPanel);
 
     PathlineLoader loader;
-    loader.loadFromXML(particleXMLFilename);
-    std::vector<PathlineRenderer::Pathline> pathlines;
-    for(auto &p : loader.getAllPathlines())
-    {
-        PathlineRenderer::Pathline pl;
-        for(auto &pn : p.points)
-            pl.points.push_back(pn.position);
-        pathlines.push_back(pl);
-    }
-    pathlineCount_ = static_cast<int>(pathlines.size());
+    loader.loadFromXML(particleXMLFilename, *threadGroup);
+    pathlineCount_ = loader.getAllPathlines().getPathlineCount();
 
     auto perspectiveCameraText = new QLabel("Perspective camera", downPanel);
 
-    renderer_          = new PathlineRenderer(upPanel, std::move(pathlines));
+    renderer_          = new PathlineRenderer(
+        upPanel, std::move(loader.getAllPathlines()), *threadGroup);
     perspectiveCamera_ = new QCheckBox(downPanel);
     useDefaultCamera_  = new QPushButton("Use default camera", downPanel);
 
@@ -54,6 +48,46 @@ PathlineVisualizer::PathlineVisualizer(
     renderCountText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     renderCountInput->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Fixed);
 
+    // animation
+
+    const float minTime = renderer_->getMinTime();
+    const float maxTime = renderer_->getMaxTime();
+
+    auto animateText = new QLabel("Animate", downPanel);
+    auto timeText    = new QLabel("Time", downPanel);
+    auto tailText    = new QLabel("Tail length", downPanel);
+
+    animate_     = new QCheckBox(downPanel);
+    play_        = new QPushButton("Play", downPanel);
+    timeSlider_  = new DoubleSlider(downPanel);
+    tailSlider_  = new DoubleSlider(downPanel);
+    playTimer_   = new QTimer(this);
+
+    // without pathlines or with a single time step there is nothing to
+    // animate. sliders still get a non-empty range, which they divide by
+
+    const bool hasTimeRange = maxTime > minTime;
+    const double sliderTimeSpan = hasTimeRange ? maxTime - minTime : 1.0;
+
+    animate_->setChecked(false);
+    animate_->setEnabled(hasTimeRange);
+    play_->setCheckable(true);
+    play_->setEnabled(false);
+
+    timeSlider_->setRange(minTime, minTime + sliderTimeSpan);
+    timeSlider_->setValue(hasTimeRange ? maxTime : minTime);
+    timeSlider_->setEnabled(false);
+
+    tailSlider_->setRange(0, sliderTimeSpan);
+    tailSlider_->setValue(0.1 * sliderTimeSpan);
+    tailSlider_->setEnabled(false);
+    renderer_->setTailLength(static_cast<float>(tailSlider_->getValue()));
+
+    animateText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    animate_->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    timeText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    tailText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+
     upLayout->addWidget(renderer_);
 
     downLayout->addWidget(perspectiveCameraText, 0, 0, 1, 1);
@@ -61,6 +95,13 @@ PathlineVisualizer::PathlineVisualizer(
     downLayout->addWidget(useDefaultCamera_,     0, 2, 1, 1);
     downLayout->addWidget(renderCountText,       0, 3, 1, 1);
     downLayout->addWidget(renderCountInput,      0, 4, 1, 1);
+    downLayout->addWidget(animateText,           1, 0, 1, 1);
+    downLayout->addWidget(animate_,              1, 1, 1, 1);
+    downLayout->addWidget(play_,                 1, 2, 1, 1);
+    downLayout->addWidget(timeText,              1, 3, 1, 1);
+    downLayout->addWidget(timeSlider_,           1, 4, 1, 1);
+    downLayout->addWidget(tailText,              2, 3, 1, 1);
+    downLayout->addWidget(tailSlider_,           2, 4, 1, 1);
 
     connect(perspectiveCamera_, &QCheckBox::stateChanged,
             [&](int)
@@ -79,4 +120,58 @@ PathlineVisualizer::PathlineVisualizer(
     {
         renderer_->setRenderedCount(newValue);
     });
+
+    // playback only changes the time uniform of the renderer
+
+    connect(animate_, &QCheckBox::stateChanged,
+            [this](int)
+    {
+        const bool animated = animate_->isChecked();
+        play_->setEnabled(animated);
+        timeSlider_->setEnabled(animated);
+        tailSlider_->setEnabled(animated);
+        if(!animated)
+        {
+            play_->setChecked(false);
+            playTimer_->stop();
+        }
+        renderer_->setAnimated(animated);
+    });
+
+    connect(play_, &QPushButton::toggled,
+            [this](bool checked)
+    {
+        play_->setText(checked ? "Pause" : "Play");
+        if(checked)
+            playTimer_->start(PLAY_INTERVAL_MS);
+        else
+            playTimer_->stop();
+    });
+
+    connect(playTimer_, &QTimer::timeout,
+            [this, minTime, maxTime]
+    {
+        const double step =
+            (maxTime - minTime) * PLAY_INTERVAL_MS / PLAY_DURATION_MS;
+        double time = timeSlider_->getValue() + step;
+        if(time > maxTime)
+            time = minTime;
+
+        timeSlider_->setValue(time);
+        renderer_->setCurrentTime(static_cast<float>(time));
+    });
+
+    connect(timeSlider_, &DoubleSlider::changingValue,
+            [this]
+    {
+        renderer_->setCurrentTime(
+            static_cast<float>(timeSlider_->getValue()));
+    });
+
+    connect(tailSlider_, &DoubleSlider::changingValue,
+            [this]
+    {
+        renderer_->setTailLength(
+            static_cast<float>(tailSlider_->getValue()));
+    });
 }
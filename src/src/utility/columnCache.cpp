@@ -0,0 +1,215 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <crius/utility/columnCache.h>
+
+namespace
+{
+
+    constexpr char MAGIC[8] = { 'C', 'R', 'I', 'U', 'S', 'C', 'C', 'H' };
+
+    constexpr uint32_t VERSION = 1;
+
+    constexpr uint64_t COLUMN_ALIGNMENT = 64;
+
+    struct Header
+    {
+        char     magic[8];
+        uint32_t version;
+        uint32_t format;
+        uint64_t sourceSize;
+        int64_t  sourceModifiedTime;
+        uint64_t columnCount;
+        uint64_t metadataSize;
+    };
+
+    // caches of different formats may be built from the same source file
+    std::string getCacheFilename(
+        const std::string &sourceFilename, uint32_t format)
+    {
+        char formatStr[9];
+        std::snprintf(formatStr, sizeof(formatStr), "%08x", format);
+        return sourceFilename + "." + formatStr + ".crius";
+    }
+
+    bool getSourceStamp(
+        const std::string &sourceFilename, uint64_t *size, int64_t *time)
+    {
+        std::error_code ec;
+
+        *size = std::filesystem::file_size(sourceFilename, ec);
+        if(ec)
+            return false;
+
+        const auto lastWrite = std::filesystem::last_write_time(
+            sourceFilename, ec);
+        if(ec)
+            return false;
+        *time = static_cast<int64_t>(lastWrite.time_since_epoch().count());
+
+        return true;
+    }
+
+    uint64_t alignUp(uint64_t offset) noexcept
+    {
+        return (offset + COLUMN_ALIGNMENT - 1)
+             / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+    }
+
+} // namespace anonymous
+
+bool ColumnCache::write(
+    const std::string         &sourceFilename,
+    uint32_t                   format,
+    const void                *metadata,
+    size_t                     metadataSize,
+    const std::vector<Column> &columns)
+{
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version      = VERSION;
+    header.format       = format;
+    header.columnCount  = columns.size();
+    header.metadataSize = metadataSize;
+
+    if(!getSourceStamp(
+        sourceFilename, &header.sourceSize, &header.sourceModifiedTime))
+        return false;
+
+    std::vector<ColumnEntry> entries(columns.size());
+    uint64_t offset = sizeof(Header)
+                    + sizeof(ColumnEntry) * columns.size()
+                    + metadataSize;
+    for(size_t i = 0; i < columns.size(); ++i)
+    {
+        offset = alignUp(offset);
+        entries[i].offset   = offset;
+        entries[i].byteSize = columns[i].byteSize;
+        offset += columns[i].byteSize;
+    }
+
+    // write into a temporary file first so that an interrupted write never
+    // leaves a truncated cache behind
+
+    const std::string cacheFilename = getCacheFilename(sourceFilename, format);
+    const std::string tempFilename  = cacheFilename + ".tmp";
+
+    {
+        std::ofstream fout(tempFilename, std::ofstream::binary);
+        if(!fout)
+            return false;
+
+        fout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        fout.write(
+            reinterpret_cast<const char *>(entries.data()),
+            sizeof(ColumnEntry) * entries.size());
+        fout.write(static_cast<const char *>(metadata), metadataSize);
+
+        const char zeros[COLUMN_ALIGNMENT] = {};
+        uint64_t position = sizeof(Header)
+                          + sizeof(ColumnEntry) * entries.size()
+                          + metadataSize;
+
+        for(size_t i = 0; i < columns.size(); ++i)
+        {
+            fout.write(zeros, entries[i].offset - position);
+            fout.write(
+                static_cast<const char *>(columns[i].data),
+                columns[i].byteSize);
+            position = entries[i].offset + columns[i].byteSize;
+        }
+
+        if(!fout)
+        {
+            fout.close();
+            std::remove(tempFilename.c_str());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempFilename, cacheFilename, ec);
+    if(ec)
+    {
+        std::remove(tempFilename.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+Box<ColumnCache> ColumnCache::open(
+    const std::string &sourceFilename,
+    uint32_t           format,
+    size_t             metadataSize)
+{
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    if(!getSourceStamp(sourceFilename, &sourceSize, &sourceModifiedTime))
+        return nullptr;
+
+    const std::string cacheFilename = getCacheFilename(sourceFilename, format);
+
+    std::error_code ec;
+    if(!std::filesystem::is_regular_file(cacheFilename, ec))
+        return nullptr;
+
+    Box<ColumnCache> ret(new ColumnCache);
+    try
+    {
+        ret->file_ = newBox<MappedFile>(cacheFilename);
+    }
+    catch(const std::exception &)
+    {
+        return nullptr;
+    }
+
+    const char *data = ret->file_->data();
+    const size_t size = ret->file_->size();
+
+    Header header;
+    if(size < sizeof(Header))
+        return nullptr;
+    std::memcpy(&header, data, sizeof(Header));
+
+    if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+       header.version            != VERSION                  ||
+       header.format             != format                   ||
+       header.sourceSize         != sourceSize               ||
+       header.sourceModifiedTime != sourceModifiedTime       ||
+       header.metadataSize       != metadataSize)
+        return nullptr;
+
+    const uint64_t tableEnd = sizeof(Header)
+                            + sizeof(ColumnEntry) * header.columnCount;
+    if(header.columnCount > size || tableEnd + metadataSize > size)
+        return nullptr;
+
+    ret->columns_.resize(header.columnCount);
+    std::memcpy(
+        ret->columns_.data(), data + sizeof(Header),
+        sizeof(ColumnEntry) * header.columnCount);
+
+    for(auto &column : ret->columns_)
+    {
+        if(column.offset % COLUMN_ALIGNMENT ||
+           column.offset > size || column.byteSize > size - column.offset)
+            return nullptr;
+    }
+
+    ret->metadata_ = data + tableEnd;
+
+    return ret;
+}
+
+const void *ColumnCache::getMetadata() const noexcept
+{
+    return metadata_;
+}
+
+size_t ColumnCache::getColumnCount() const noexcept
+{
+    return columns_.size();
+}
@@ -0,0 +1,30 @@
+#include <stdexcept>
+
+#include <crius/utility/mappedFile.h>
+
+MappedFile::MappedFile(const std::string &filename)
+    : file_(QString::fromStdString(filename)), data_(nullptr), size_(0)
+{
+    if(!file_.open(QIODevice::ReadOnly))
+        throw std::runtime_error("failed to open file: " + filename);
+
+    size_ = file_.size();
+    data_ = file_.map(0, size_, QFileDevice::MapPrivateOption);
+    if(!data_)
+        throw std::runtime_error("failed to map file: " + filename);
+}
+
+MappedFile::~MappedFile()
+{
+    file_.unmap(data_);
+}
+
+char *MappedFile::data() noexcept
+{
+    return reinterpret_cast<char *>(data_);
+}
+
+size_t MappedFile::size() const noexcept
+{
+    return static_cast<size_t>(size_);
+}
@@ -1,4 +1,5 @@
 #include <QPainter>
+#include <QPushButton>
 
 #include <agz/utility/misc.h>
 #include <agz/utility/texture.h>
@@ -156,6 +157,9 @@ VelocityContour::VelocityContour(
     colorMapper_->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
     downLayout->addWidget(colorMapper_, 0, 2, 2, 1);
 
+    auto fitColorRange = new QPushButton("Fit color range to view", downPanel);
+    downLayout->addWidget(fitColorRange, 3, 0, 1, 3);
+
     colorBar_ = new ColorBar(upPanel, colorMapper_);
     colorBar_->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Ignored);
     upLayout->addWidget(colorBar_);
@@ -198,6 +202,12 @@ VelocityContour::VelocityContour(
         render();
     });
 
+    connect(fitColorRange, &QPushButton::clicked,
+            [&](bool)
+    {
+        fitColorMapperVelRangeToView();
+    });
+
     connect(colorMapper_, &VelocityColorMapper::editParams,
             [&]
     {
@@ -392,6 +402,36 @@ void VelocityContour::updateColorMapperVelRange()
     colorBar_->setParams(velL, velU);
 }
 
+void VelocityContour::fitColorMapperVelRangeToView()
+{
+    const auto component = VelocityField::VelocityComponent(
+        velocityComponent_->currentIndex());
+
+    int horiAxis, vertAxis, depthAxis;
+    getRenderAxis(&horiAxis, &vertAxis, &depthAxis);
+
+    const float depth = static_cast<float>(depthSlider_->getValue());
+
+    AABB region;
+    region.lower[horiAxis]  = leftBottomWorldPos_.x;
+    region.lower[vertAxis]  = leftBottomWorldPos_.y;
+    region.lower[depthAxis] = depth;
+    region.upper[horiAxis]  = rightTopWorldPos_.x;
+    region.upper[vertAxis]  = rightTopWorldPos_.y;
+    region.upper[depthAxis] = depth;
+
+    const auto range = threadLocalVelocityField_[0]->getVelocityRange(
+        region, component);
+    if(!range)
+        return;
+
+    colorMapper_->setVelocityRange(range->low, range->high);
+    colorBar_->setParams(range->low, range->high);
+
+    isCacheDirty_ = true;
+    render();
+}
+
 void VelocityContour::render()
 {
     const auto component = VelocityField::VelocityComponent(
@@ -1,5 +1,17 @@
+#include <algorithm>
+#include <atomic>
+
 #include <crius/velocityField/contour/velocityContourCache.h>
 
+namespace
+{
+
+    // side length in pixels of contour tiles, which are skipped as a whole
+    // when outside the field
+    constexpr int CONTOUR_TILE_SIZE = 64;
+
+} // namespace anonymous
+
 VelocityContourCache VelocityContourCache::build(
     const VelocityColorMapper                  &colorMapper,
     int                                         resolution,
@@ -27,7 +39,13 @@ VelocityContourCache VelocityContourCache::build(
         return a * Vec2(x, y) + b;
     };
 
-    std::atomic<int> globalY = 0;
+    // pixels are processed in square tiles. a tile whose part of the slice
+    // is outside the field keeps the background without any cell lookup
+
+    const int tilesPerRow = (resolution + CONTOUR_TILE_SIZE - 1) / CONTOUR_TILE_SIZE;
+    const int tileCount   = tilesPerRow * tilesPerRow;
+
+    std::atomic<int> globalTile = 0;
     threadGroup.run(
         threadCount, [&](int threadIndex)
     {
@@ -35,34 +53,57 @@ VelocityContourCache VelocityContourCache::build(
 
         for(;;)
         {
-            const int y = globalY++;
-            if(y >= resolution)
+            const int tile = globalTile++;
+            if(tile >= tileCount)
                 return;
 
-            Vec3 worldPos;
-            worldPos[axisIndices.z] = depth;
+            const int xBeg = tile % tilesPerRow * CONTOUR_TILE_SIZE;
+            const int yBeg = tile / tilesPerRow * CONTOUR_TILE_SIZE;
+            const int xEnd = (std::min)(xBeg + CONTOUR_TILE_SIZE, resolution);
+            const int yEnd = (std::min)(yBeg + CONTOUR_TILE_SIZE, resolution);
 
-            for(int x = 0; x < resolution; ++x)
-            {
-                const Vec2 worldXY = pixelToWorld(x, y);
+            const Vec2 tileLB = pixelToWorld(xBeg, yBeg);
+            const Vec2 tileRT = pixelToWorld(xEnd - 1, yEnd - 1);
 
-                worldPos[axisIndices.x] = worldXY.x;
-                worldPos[axisIndices.y] = worldXY.y;
+            AABB tileRegion;
+            tileRegion.lower[axisIndices.x] = tileLB.x;
+            tileRegion.lower[axisIndices.y] = tileLB.y;
+            tileRegion.lower[axisIndices.z] = depth;
+            tileRegion.upper[axisIndices.x] = tileRT.x;
+            tileRegion.upper[axisIndices.y] = tileRT.y;
+            tileRegion.upper[axisIndices.z] = depth;
 
-                const auto vel = velocityField.getVelocity(worldPos);
-                if(!vel)
-                    continue;
+            if(velocityField.getOccupancy(tileRegion) ==
+               VelocityField::Occupancy::Outside)
+                continue;
 
-                QColor color;
-                if(component == VelocityField::X)
-                    color = colorMapper.getColor(vel->x);
-                else if(component == VelocityField::Y)
-                    color = colorMapper.getColor(vel->y);
-                else
-                    color = colorMapper.getColor(vel->z);
+            Vec3 worldPos;
+            worldPos[axisIndices.z] = depth;
 
-                ret.cache_(y, x) = to_color3b(agz::math::color3f(
-                    color.redF(), color.greenF(), color.blueF()));
+            for(int y = yBeg; y < yEnd; ++y)
+            {
+                for(int x = xBeg; x < xEnd; ++x)
+                {
+                    const Vec2 worldXY = pixelToWorld(x, y);
+
+                    worldPos[axisIndices.x] = worldXY.x;
+                    worldPos[axisIndices.y] = worldXY.y;
+
+                    const auto vel = velocityField.getVelocity(worldPos);
+                    if(!vel)
+                        continue;
+
+                    QColor color;
+                    if(component == VelocityField::X)
+                        color = colorMapper.getColor(vel->x);
+                    else if(component == VelocityField::Y)
+                        color = colorMapper.getColor(vel->y);
+                    else
+                        color = colorMapper.getColor(vel->z);
+
+                    ret.cache_(y, x) = to_color3b(agz::math::color3f(
+                        color.redF(), color.greenF(), color.blueF()));
+                }
             }
         }
     });
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <string>
 #include <random>
 
@@ -11,11 +14,73 @@
 
 #include <agz/utility/system.h>
 
+#include <crius/common/frustum.h>
+#include <crius/utility/morton.h>
+#include <crius/utility/parallelFor.h>
+#include <crius/utility/radixSort.h>
 #include <crius/velocityField/field3D/fieldRenderer.h>
 #include <crius/velocityField/velocityField.h>
 
-FieldRenderer::FieldRenderer(QWidget* parent, const VelocityField* velocityField, HSVColorMapper* colorMapper)
-	: QOpenGLWidget(parent), velocityField_(velocityField), colorMapper_(colorMapper)
+namespace
+{
+	// random and halton sampling give up after this many candidates per
+	// requested sample, which bounds sampling time of sparse fields
+	constexpr long MAX_CANDIDATES_PER_SAMPLE = 64;
+
+	// uniform sampling tries each grid cell at most this many times
+	constexpr int MAX_TRIES_PER_CELL = 10;
+
+	// candidates are evaluated in rounds of at least this many per thread
+	constexpr long MIN_CANDIDATES_PER_THREAD = 64;
+
+	// stateless random numbers, so that a candidate depends only on its index
+	uint64_t hashIndex(uint64_t x)
+	{
+		x += 0x9e3779b97f4a7c15ull;
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	}
+
+	float hashToUnitFloat(uint64_t x)
+	{
+		return static_cast<float>(hashIndex(x) >> 40) * (1.0f / (1 << 24));
+	}
+
+	// candidates in voxels known to be outside the field are rejected
+	// without a cell lookup
+	std::optional<Vec3> sampleVelocity(const VelocityField& field, const Vec3& point)
+	{
+		if (field.getOccupancy(point) == VelocityField::Occupancy::Outside)
+			return std::nullopt;
+		return field.getVelocity(point);
+	}
+
+	// importance sampling estimates where arrows are needed on a grid with
+	// this many cells along its longest axis
+	constexpr int IMPORTANCE_GRID_RESOLUTION = 64;
+
+	// every valid grid cell gets at least this weight, so that calm regions
+	// are not left empty
+	constexpr float IMPORTANCE_BASE_WEIGHT = 0.1f;
+
+	// arrows are culled in chunks of this many morton-sorted instances
+	constexpr int ARROW_CHUNK_SIZE = 4096;
+
+	// chunks whose arrows are smaller than this many pixels on screen are
+	// thinned out in proportion to the arrow area
+	constexpr float FULL_DETAIL_ARROW_PIXELS = 4.0f;
+
+	// arrow colors are looked up from the color mapper sampled at this many
+	// uniformly spaced speeds
+	constexpr int COLOR_MAP_SIZE = 256;
+}
+
+FieldRenderer::FieldRenderer(
+	QWidget* parent, const VelocityField* velocityField, HSVColorMapper* colorMapper,
+	RC<agz::thread::thread_group_t> threadGroup)
+	: QOpenGLWidget(parent), velocityField_(velocityField), colorMapper_(colorMapper),
+	  threadGroup_(std::move(threadGroup))
 {
 	QSurfaceFormat format;
 	format.setMajorVersion(3);
@@ -34,7 +99,8 @@ FieldRenderer::~FieldRenderer()
 	makeCurrent();
 	glDeleteVertexArrays(1, &vao_);
 	glDeleteBuffers(1, &vbo_);
-	glDeleteBuffers(1, &instanceVBO_);
+	instanceBuffer_.destroy();
+	glDeleteTextures(1, &colorMapTexture_);
 	delete shaderProgram_;
 	doneCurrent();
 }
@@ -57,8 +123,12 @@ void FieldRenderer::initializeGL()
 	glEnableVertexAttribArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+	instanceBuffer_.create(this);
 	bindInstanceVBOForPaint();
 
+	glGenTextures(1, &colorMapTexture_);
+	updateColorMap();
+
 	glEnable(GL_DEPTH_TEST);
 }
 
@@ -74,11 +144,64 @@ void FieldRenderer::paintGL()
 	projection.perspective(fov_, 1.0f * width() / height(), 0.1f, 100.0f);
 	shaderProgram_->setUniformValue("view", view);
 	shaderProgram_->setUniformValue("projection", projection);
+	const Vec3 scale = scale_ * scaleResize_;
+	shaderProgram_->setUniformValue("arrowScale", QVector3D(scale.x, scale.y, scale.z));
+	shaderProgram_->setUniformValue("minVelocity", minVelocity_);
+	shaderProgram_->setUniformValue("maxVelocity", maxVelocity_);
+	shaderProgram_->setUniformValue("colorMap", 0);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_1D, colorMapTexture_);
+
+	// chunks outside the view frustum are skipped. instances in a chunk are
+	// in sampling order, so any prefix of a chunk is spread over the whole
+	// chunk, and distant chunks draw a prefix whose size follows the arrow
+	// area on screen. adjacent fully drawn chunks are merged into one draw
+
+	const QVector3D viewDir = (lookAt_ - eye_).normalized();
+	const Vec3 eye(eye_.x(), eye_.y(), eye_.z());
+	const Vec3 dir(viewDir.x(), viewDir.y(), viewDir.z());
+	const float fovY = radians(fov_);
+	const Frustum frustum = Frustum::perspective(eye, dir, fovY, 1.0f * width() / height());
+	const float arrowRadius = arrowRadius_ * scale.max_elem();
+	const float pixelScale = 0.5f * height() / std::tan(0.5f * fovY);
+
+	std::vector<std::pair<int, int>> runs;
+	for (auto& chunk : arrowChunks_)
+	{
+		if (frustum.isOutside(chunk.bound, arrowRadius))
+			continue;
+
+		const Vec3 center = 0.5f * (chunk.bound.lower + chunk.bound.upper);
+		const Vec3 extent = 0.5f * (chunk.bound.upper - chunk.bound.lower);
+		const float nearestDepth = dot(center - eye, dir)
+			- std::abs(dir.x) * extent.x
+			- std::abs(dir.y) * extent.y
+			- std::abs(dir.z) * extent.z;
+		const float arrowPixels = arrowRadius * pixelScale / (std::max)(nearestDepth, 1e-4f);
+
+		int count = chunk.count;
+		if (arrowPixels < FULL_DETAIL_ARROW_PIXELS)
+		{
+			const float ratio = arrowPixels / FULL_DETAIL_ARROW_PIXELS;
+			count = (std::max)(1, static_cast<int>(std::ceil(count * ratio * ratio)));
+		}
+
+		if (!runs.empty() && runs.back().first + runs.back().second == chunk.first)
+			runs.back().second += count;
+		else
+			runs.push_back({ chunk.first, count });
+	}
 
 	glBindVertexArray(vao_);
-	glDrawArraysInstanced(GL_TRIANGLES, 0, arrowVertices_.size(), sampleNum_);
+	for (auto& run : runs)
+	{
+		bindInstanceData(run.first);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, arrowVertices_.size(), run.second);
+	}
 
 	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_1D, 0);
 	shaderProgram_->release();
 }
 
@@ -147,11 +270,19 @@ void FieldRenderer::init()
 	middleBtnPressed_ = false;
 
 	loadArrowMesh();
+
+	importanceGrid_.reset();
+	importanceCdf_.clear();
+
+	threadCount_ = agz::thread::actual_worker_count(-1);
+	threadLocalVelocityField_.clear();
+	for (int i = 0; i < threadCount_; i++)
+		threadLocalVelocityField_.push_back(velocityField_->cloneForParallelAccess());
 	
-	float maxVelocity = velocityField_->getMaxVelocity(FluentVelocityField::All);
-	float minVelocity = velocityField_->getMinVelocity(FluentVelocityField::All);
+	maxVelocity_ = velocityField_->getMaxVelocity(FluentVelocityField::All);
+	minVelocity_ = velocityField_->getMinVelocity(FluentVelocityField::All);
 
-	colorMapper_->setVelocityRange(minVelocity, maxVelocity);
+	colorMapper_->setVelocityRange(minVelocity_, maxVelocity_);
 
 	velocityFieldBBox_ = velocityField_->getBoundingBox();
 	velocityFiledCenter_[0] = (velocityFieldBBox_.lower.x + velocityFieldBBox_.upper.x) / 2;
@@ -164,7 +295,7 @@ void FieldRenderer::init()
 	sampleType_ = HALTONSAMPLE;
 	samplePoints(velocityFieldBBox_, sampleNum_);
 
-	constructInstanceData(colorMapper_, scale_ * scaleResize_);
+	constructInstanceData();
 
 	// camera params
 
@@ -179,6 +310,8 @@ void FieldRenderer::loadArrowMesh()
 {
 	std::string objFile = "asset/arrow.obj";
 	auto triangles = agz::mesh::load_from_file(objFile);
+	arrowVertices_.clear();
+	arrowRadius_ = 0;
 	Vec3 lower = Vec3(std::numeric_limits<float>::max());
 	Vec3 upper = Vec3(-std::numeric_limits<float>::max());
 	for (auto& triangle : triangles)
@@ -187,6 +320,7 @@ void FieldRenderer::loadArrowMesh()
 		{
 			Vec3 position = triangle.vertices[i].position;
 			arrowVertices_.push_back(position);
+			arrowRadius_ = (std::max)(arrowRadius_, position.length());
 			lower.x = position.x < lower.x ? position.x : lower.x;
 			lower.y = position.y < lower.y ? position.y : lower.y;
 			lower.z = position.z < lower.z ? position.z : lower.z;
@@ -203,17 +337,31 @@ bool FieldRenderer::createShader()
 {
 	shaderProgram_ = new QOpenGLShaderProgram(this);
 
+	// arrows point along +y in model space, and are rotated into an
+	// orthonormal frame whose y axis is the velocity direction
 	const char* vertexShaderSource =
 		"#version 330 core\n"
 		"layout(location = 0) in vec3 aPos;\n"
-		"layout(location = 1) in vec3 aColor;\n"
-		"layout(location = 2) in mat4 aModelMatrix;\n"
+		"layout(location = 1) in vec3 aOffset;\n"
+		"layout(location = 2) in vec3 aVelocity;\n"
 		"out vec3 fColor;\n"
 		"uniform mat4 view;\n"
 		"uniform mat4 projection;\n"
+		"uniform vec3 arrowScale;\n"
+		"uniform float minVelocity;\n"
+		"uniform float maxVelocity;\n"
+		"uniform sampler1D colorMap;\n"
 		"void main() {\n"
-		"   gl_Position = projection * view * aModelMatrix * vec4(aPos, 1.0f);\n"
-		"   fColor = aColor;\n"
+		"   float speed = length(aVelocity);\n"
+		"   vec3 y = speed > 0 ? aVelocity / speed : vec3(0, 1, 0);\n"
+		"   vec3 a = abs(y.x) > 0.9 ? vec3(0, 1, 0) : vec3(1, 0, 0);\n"
+		"   vec3 z = normalize(cross(a, y));\n"
+		"   vec3 x = cross(y, z);\n"
+		"   vec3 p = aPos * arrowScale;\n"
+		"   vec3 worldPos = aOffset + p.x * x + p.y * y + p.z * z;\n"
+		"   gl_Position = projection * view * vec4(worldPos, 1.0f);\n"
+		"   float t = (speed - minVelocity) / max(maxVelocity - minVelocity, 1e-6);\n"
+		"   fColor = texture(colorMap, t).rgb;\n"
 		"}\n";
 
 	const char* fragmentShaderSource =
@@ -274,39 +422,92 @@ void FieldRenderer::samplePoints(const AABB& bbox, long sampleNum)
 		uniformSamplePoints(bbox, sampleNum);
 	else if (sampleType_ == HALTONSAMPLE)
 		haltonSamplePoints(bbox, sampleNum);
+	else if (sampleType_ == IMPORTANCESAMPLE)
+		importanceSamplePoints(sampleNum);
 }
 
-void FieldRenderer::randomSamplePoints(const AABB& bbox, long sampleNum)
+void FieldRenderer::collectSamples(
+	long candidateCount, long sampleNum,
+	const std::function<bool(const VelocityField&, long, Vec3&, Vec3&)>& tryCandidate)
 {
-	std::random_device seed;
-	std::mt19937_64 gen(seed());
-	std::uniform_real_distribution<> distX(bbox.lower.x, bbox.upper.x),
-		distY(bbox.lower.y, bbox.upper.y), distZ(bbox.lower.z, bbox.upper.z);
-	int i = 0;
+	// candidates are evaluated in rounds. each thread takes a contiguous slice
+	// of a round, and accepted samples are gathered in candidate order, so
+	// the result does not depend on thread scheduling
+
 	velPointsSamples_.clear();
 	velocitySamples_.clear();
-	while (i < sampleNum)
+
+	std::vector<std::vector<Vec3>> threadPoints(threadCount_), threadVelocities(threadCount_);
+
+	long nextCandidate = 0;
+	while (nextCandidate < candidateCount && velPointsSamples_.size() < sampleNum)
 	{
-		Vec3 point;
-		point.x = distX(gen);
-		point.y = distY(gen);
-		point.z = distZ(gen);
-		auto optVelocity = velocityField_->getVelocity(point);
-		if (!optVelocity) continue;
-		Vec3 velocity = *optVelocity;
-		velPointsSamples_.push_back(point);
-		velocitySamples_.push_back(velocity);
-		i++;
+		const long remaining = sampleNum - velPointsSamples_.size();
+		const long roundSize = (std::min)(
+			candidateCount - nextCandidate,
+			(std::max)(2 * remaining, MIN_CANDIDATES_PER_THREAD * threadCount_));
+		const long roundBeg = nextCandidate;
+
+		threadGroup_->run(threadCount_, [&](int threadIndex)
+		{
+			const long beg = roundBeg + roundSize * threadIndex / threadCount_;
+			const long end = roundBeg + roundSize * (threadIndex + 1) / threadCount_;
+			const VelocityField& field = *threadLocalVelocityField_[threadIndex];
+
+			auto& points = threadPoints[threadIndex];
+			auto& velocities = threadVelocities[threadIndex];
+			points.clear();
+			velocities.clear();
+
+			for (long i = beg; i < end; i++)
+			{
+				Vec3 point, velocity;
+				if (tryCandidate(field, i, point, velocity))
+				{
+					points.push_back(point);
+					velocities.push_back(velocity);
+				}
+			}
+		});
+
+		for (int t = 0; t < threadCount_ && velPointsSamples_.size() < sampleNum; t++)
+		{
+			for (size_t i = 0; i < threadPoints[t].size() && velPointsSamples_.size() < sampleNum; i++)
+			{
+				velPointsSamples_.push_back(threadPoints[t][i]);
+				velocitySamples_.push_back(threadVelocities[t][i]);
+			}
+		}
+
+		nextCandidate += roundSize;
 	}
 }
 
+void FieldRenderer::randomSamplePoints(const AABB& bbox, long sampleNum)
+{
+	std::random_device seed;
+	const uint64_t seedValue = (static_cast<uint64_t>(seed()) << 32) | seed();
+	const Vec3 extent = bbox.upper - bbox.lower;
+	collectSamples(
+		sampleNum * MAX_CANDIDATES_PER_SAMPLE, sampleNum,
+		[&](const VelocityField& field, long index, Vec3& point, Vec3& velocity)
+		{
+			const uint64_t key = hashIndex(seedValue ^ static_cast<uint64_t>(index));
+			point.x = bbox.lower.x + extent.x * hashToUnitFloat(key);
+			point.y = bbox.lower.y + extent.y * hashToUnitFloat(key + 1);
+			point.z = bbox.lower.z + extent.z * hashToUnitFloat(key + 2);
+			auto optVelocity = sampleVelocity(field, point);
+			if (!optVelocity)
+				return false;
+			velocity = *optVelocity;
+			return true;
+		});
+}
+
 void FieldRenderer::uniformSamplePoints(const AABB& bbox, long sampleNum)
 {
 	std::random_device seed;
-	std::mt19937_64 gen(seed());
-	std::uniform_real_distribution<> dist(0, 1);
-	velPointsSamples_.clear();
-	velocitySamples_.clear();
+	const uint64_t seedValue = (static_cast<uint64_t>(seed()) << 32) | seed();
 	const Vec3 extent = bbox.upper - bbox.lower;
 	float vBBox = extent.product();
 	float theta = pow(1.0 * sampleNum / vBBox, 1.0 / 3);
@@ -314,59 +515,146 @@ void FieldRenderer::uniformSamplePoints(const AABB& bbox, long sampleNum)
 	int numY = ceil(theta * (bbox.upper.y - bbox.lower.y));
 	int numZ = ceil(theta * (bbox.upper.z - bbox.lower.z));
 	const float boxSidelen = (extent / Vec3(numX, numY, numZ)).max_elem();
-	for (int i = 0; i < numX; i++)
-	{
-		for (int j = 0; j < numY; j++)
+	const long cellCount = static_cast<long>(numX) * numY * numZ;
+
+	// each grid cell is a candidate, and yields at most one sample
+	collectSamples(
+		cellCount, cellCount,
+		[&](const VelocityField& field, long index, Vec3& point, Vec3& velocity)
 		{
-			for (int k = 0; k < numZ; k++)
+			const int k = index % numZ;
+			const int j = index / numZ % numY;
+			const int i = index / numZ / numY;
+			for (int s = 0; s < MAX_TRIES_PER_CELL; s++)
 			{
-				for (int s = 0; s < 10; s++)
+				const uint64_t key = hashIndex(
+					seedValue ^ static_cast<uint64_t>(index * MAX_TRIES_PER_CELL + s));
+				point.x = bbox.lower.x + (i + hashToUnitFloat(key)) * boxSidelen;
+				point.y = bbox.lower.y + (j + hashToUnitFloat(key + 1)) * boxSidelen;
+				point.z = bbox.lower.z + (k + hashToUnitFloat(key + 2)) * boxSidelen;
+				auto optVelocity = sampleVelocity(field, point);
+				if (optVelocity)
 				{
-					Vec3 point;
-					point.x = bbox.lower.x + (i + dist(gen)) * boxSidelen;
-					point.y = bbox.lower.y + (j + dist(gen)) * boxSidelen;
-					point.z = bbox.lower.z + (k + dist(gen)) * boxSidelen;
-					auto optVelocity = velocityField_->getVelocity(point);
-					if (!optVelocity)
-						continue;
-					else
-					{
-						Vec3 velocity = *optVelocity;
-						velPointsSamples_.push_back(point);
-						velocitySamples_.push_back(velocity);
-						break;
-					}
+					velocity = *optVelocity;
+					return true;
 				}
-				
 			}
-		}
-	}
+			return false;
+		});
 }
 
 void FieldRenderer::haltonSamplePoints(const AABB& bbox, long sampleNum)
 {
-	int i = 1;
-	velPointsSamples_.clear();
-	velocitySamples_.clear();
 	float dx = bbox.upper.x - bbox.lower.x;
 	float dy = bbox.upper.y - bbox.lower.y;
 	float dz = bbox.upper.z - bbox.lower.z;
-	while (true)
+
+	// candidate index i is the (i + 1)th point of the halton sequence
+	collectSamples(
+		sampleNum * MAX_CANDIDATES_PER_SAMPLE, sampleNum,
+		[&](const VelocityField& field, long index, Vec3& point, Vec3& velocity)
+		{
+			const int i = static_cast<int>(index + 1);
+			point.x = bbox.lower.x + dx * radicalInverseFunction(i, 2);
+			point.y = bbox.lower.y + dy * radicalInverseFunction(i, 3);
+			point.z = bbox.lower.z + dz * radicalInverseFunction(i, 5);
+			auto optVelocity = sampleVelocity(field, point);
+			if (!optVelocity)
+				return false;
+			velocity = *optVelocity;
+			return true;
+		});
+}
+
+void FieldRenderer::buildImportanceGrid()
+{
+	importanceGrid_ = newRC<VelocityGrid>(*velocityField_, IMPORTANCE_GRID_RESOLUTION, *threadGroup_);
+	const VelocityGrid& grid = *importanceGrid_;
+	const Vec3i res = grid.getResolution();
+	const float invMaxSpeed = grid.getMaxSpeed() > 0 ? 1 / grid.getMaxSpeed() : 0.0f;
+
+	// weight of a cell grows with its speed and with the largest velocity
+	// difference to its valid neighbors, both relative to the max speed
+	importanceCdf_.resize(grid.getCellCount());
+	float sum = 0;
+	for (int z = 0; z < res.z; z++)
 	{
-		Vec3 point;
-		point.x = bbox.lower.x + dx * radicalInverseFunction(i, 2);
-		point.y = bbox.lower.y + dy * radicalInverseFunction(i, 3);
-		point.z = bbox.lower.z + dz * radicalInverseFunction(i, 5);
-		auto optVelocity = velocityField_->getVelocity(point);
-		i++;
-		if (!optVelocity) continue;
-		Vec3 velocity = *optVelocity;
-		velPointsSamples_.push_back(point);
-		velocitySamples_.push_back(velocity);
-		if (velPointsSamples_.size() >= sampleNum)
-			break;
+		for (int y = 0; y < res.y; y++)
+		{
+			for (int x = 0; x < res.x; x++)
+			{
+				const int index = grid.getCellIndex(x, y, z);
+				if (grid.isValid(index))
+				{
+					const Vec3& velocity = grid.getVelocity(index);
+					float variation = 0;
+					const auto visit = [&](int nx, int ny, int nz)
+					{
+						if (nx < 0 || ny < 0 || nz < 0 || nx >= res.x || ny >= res.y || nz >= res.z)
+							return;
+						const int neighbor = grid.getCellIndex(nx, ny, nz);
+						if (grid.isValid(neighbor))
+							variation = (std::max)(variation, (grid.getVelocity(neighbor) - velocity).length());
+					};
+					visit(x - 1, y, z);
+					visit(x + 1, y, z);
+					visit(x, y - 1, z);
+					visit(x, y + 1, z);
+					visit(x, y, z - 1);
+					visit(x, y, z + 1);
+
+					sum += IMPORTANCE_BASE_WEIGHT
+						+ velocity.length() * invMaxSpeed
+						+ (std::min)(variation * invMaxSpeed, 1.0f);
+				}
+				importanceCdf_[index] = sum;
+			}
+		}
 	}
+}
 
+void FieldRenderer::importanceSamplePoints(long sampleNum)
+{
+	if (!importanceGrid_)
+		buildImportanceGrid();
+
+	const VelocityGrid& grid = *importanceGrid_;
+	const float totalWeight = importanceCdf_.empty() ? 0.0f : importanceCdf_.back();
+	if (totalWeight <= 0)
+	{
+		velPointsSamples_.clear();
+		velocitySamples_.clear();
+		return;
+	}
+
+	const Vec3i res = grid.getResolution();
+	const Vec3& cellSize = grid.getCellSize();
+	const Vec3& lower = grid.getBoundingBox().lower;
+
+	// the first halton dimension picks a cell by its weight, and the others
+	// place the candidate inside the cell
+	collectSamples(
+		sampleNum * MAX_CANDIDATES_PER_SAMPLE, sampleNum,
+		[&](const VelocityField& field, long index, Vec3& point, Vec3& velocity)
+		{
+			const int i = static_cast<int>(index + 1);
+			const float u = totalWeight * radicalInverseFunction(i, 2);
+			const int cell = static_cast<int>((std::min)(
+				std::upper_bound(importanceCdf_.begin(), importanceCdf_.end(), u) - importanceCdf_.begin(),
+				static_cast<std::ptrdiff_t>(importanceCdf_.size() - 1)));
+
+			const int x = cell % res.x;
+			const int y = cell / res.x % res.y;
+			const int z = cell / res.x / res.y;
+			point.x = lower.x + (x + radicalInverseFunction(i, 3)) * cellSize.x;
+			point.y = lower.y + (y + radicalInverseFunction(i, 5)) * cellSize.y;
+			point.z = lower.z + (z + radicalInverseFunction(i, 7)) * cellSize.z;
+			auto optVelocity = sampleVelocity(field, point);
+			if (!optVelocity)
+				return false;
+			velocity = *optVelocity;
+			return true;
+		});
 }
 
 float FieldRenderer::radicalInverseFunction(int a, int b)
@@ -382,31 +670,51 @@ float FieldRenderer::radicalInverseFunction(int a, int b)
 	return r;
 }
 
-void FieldRenderer::constructInstanceData(HSVColorMapper* colorMapper, Vec3 scale)
+void FieldRenderer::constructInstanceData()
 {
-	instanceDatas_.clear();
-	for (int i = 0; i < velPointsSamples_.size(); i++) 
-	{
-		Mat4 modelMatrix = getModelMatrix(velPointsSamples_[i], velocitySamples_[i], scale);
-		QColor qColor = colorMapper->getColor(velocitySamples_[i]);
-		Vec3 color(qColor.redF(), qColor.greenF(), qColor.blueF());
-		instanceDatas_.push_back(InstanceData(color, modelMatrix));
-	}
-}
+	const int count = static_cast<int>(velPointsSamples_.size());
 
-Mat4 FieldRenderer::getModelMatrix(Vec3 point, Vec3 velocity, Vec3 scale)
-{
-	Mat4 modelMatrix;
-	Mat4 scaleMatrix = Mat4::left_transform::scale(scale);
-	Mat4 translateMartix = Mat4::left_transform::translate(point);
-	auto frame = agz::math::tcoord3<float>::from_y(velocity);
-	Vec4 rotateX = Vec4(frame.x[0], frame.x[1], frame.x[2], 0);
-	Vec4 rotateY = Vec4(frame.y[0], frame.y[1], frame.y[2], 0);
-	Vec4 rotateZ = Vec4(frame.z[0], frame.z[1], frame.z[2], 0);
-	Vec4 rotateW = Vec4(0, 0, 0, 1);
-	Mat4 rotateMatrix = Mat4::from_cols(rotateX, rotateY, rotateZ, rotateW);
-	modelMatrix = translateMartix * rotateMatrix * scaleMatrix;
-	return modelMatrix;
+	// sort sample indices along a morton curve
+
+	std::vector<uint64_t> keys(count);
+	std::vector<int> order(count);
+	parallelForBlocks(*threadGroup_, threadCount_, count, ARROW_CHUNK_SIZE,
+		[&](int, size_t beg, size_t end)
+		{
+			for (size_t i = beg; i < end; i++)
+			{
+				keys[i] = mortonCode(velPointsSamples_[i], velocityFieldBBox_);
+				order[i] = static_cast<int>(i);
+			}
+		});
+	parallelRadixSort(keys, order, *threadGroup_, threadCount_);
+	keys = std::vector<uint64_t>();
+
+	// split into chunks, and restore sampling order inside each chunk
+
+	const int chunkCount = (count + ARROW_CHUNK_SIZE - 1) / ARROW_CHUNK_SIZE;
+	arrowChunks_.resize(chunkCount);
+	instanceDatas_.resize(count);
+	parallelForBlocks(*threadGroup_, threadCount_, chunkCount, 1,
+		[&](int, size_t chunkIndex, size_t)
+		{
+			ArrowChunk& chunk = arrowChunks_[chunkIndex];
+			chunk.first = static_cast<int>(chunkIndex) * ARROW_CHUNK_SIZE;
+			chunk.count = (std::min)(ARROW_CHUNK_SIZE, count - chunk.first);
+
+			auto beg = order.begin() + chunk.first;
+			std::sort(beg, beg + chunk.count);
+
+			chunk.bound.lower = Vec3(std::numeric_limits<float>::max());
+			chunk.bound.upper = Vec3(-std::numeric_limits<float>::max());
+			for (int i = chunk.first; i < chunk.first + chunk.count; i++)
+			{
+				const Vec3& position = velPointsSamples_[order[i]];
+				instanceDatas_[i] = InstanceData(position, velocitySamples_[order[i]]);
+				chunk.bound.lower = elem_min(chunk.bound.lower, position);
+				chunk.bound.upper = elem_max(chunk.bound.upper, position);
+			}
+		});
 }
 
 float FieldRenderer::getArrowSize(AABB bbox1, AABB bbox2, long sampleNum) 
@@ -441,8 +749,6 @@ void FieldRenderer::setArrowZSize(float z)
 
 void FieldRenderer::renderForReScaleArrow()
 {
-	updateInstanceOfMatrix(scale_ * scaleResize_);
-	updataInstanceVBO();
 	update();
 }
 
@@ -458,15 +764,6 @@ float FieldRenderer::getArrowScale(int axis)
 		return scaleResize_.length();
 }
 
-void FieldRenderer::updateInstanceOfMatrix(Vec3 scale)
-{
-	for (int i = 0; i < instanceDatas_.size(); i++)
-	{
-		Mat4 modelMatrix = getModelMatrix(velPointsSamples_[i], velocitySamples_[i], scale);
-		instanceDatas_[i].modelMatrix_ = modelMatrix;
-	}
-}
-
 long FieldRenderer::getSampleNums()
 {
 	return sampleNum_;
@@ -480,51 +777,56 @@ void FieldRenderer::setSampleNums(long sampleNum)
 void FieldRenderer::renderForReSample()
 {
 	samplePoints(velocityFieldBBox_, sampleNum_);
-	constructInstanceData(colorMapper_, scale_ * scaleResize_);
+	constructInstanceData();
 	updataInstanceVBO();
 	update();
 }
 
-void FieldRenderer::updateInstanceofColor()
+void FieldRenderer::updateColorMap()
 {
-	for (int i = 0; i < instanceDatas_.size(); i++)
+	std::vector<Vec3> colors(COLOR_MAP_SIZE);
+	for (int i = 0; i < COLOR_MAP_SIZE; i++)
 	{
-		QColor qColor = colorMapper_->getColor(velocitySamples_[i]);
-		Vec3 color(qColor.redF(), qColor.greenF(), qColor.blueF());
-		instanceDatas_[i].color_ = color;
+		float t = 1.0f * i / (COLOR_MAP_SIZE - 1);
+		QColor qColor = colorMapper_->getColor(agz::math::lerp(minVelocity_, maxVelocity_, t));
+		colors[i] = Vec3(qColor.redF(), qColor.greenF(), qColor.blueF());
 	}
-	updataInstanceVBO();
-	update();
+
+	glBindTexture(GL_TEXTURE_1D, colorMapTexture_);
+	glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB32F, COLOR_MAP_SIZE, 0, GL_RGB, GL_FLOAT, colors.data());
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_1D, 0);
 }
 
 void FieldRenderer::updataInstanceVBO()
 {
+	// the instance buffer keeps its name, so attribute bindings in vao_ stay valid
 	makeCurrent();
-	glDeleteBuffers(1, &instanceVBO_);
-	glBindVertexArray(vao_);
-	bindInstanceVBOForPaint();
+	instanceBuffer_.setData(instanceDatas_.data(), instanceDatas_.size() * sizeof(InstanceData));
 	doneCurrent();
 }
 
 void FieldRenderer::bindInstanceVBOForPaint()
 {
-	glGenBuffers(1, &instanceVBO_);
-	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO_);
-	glBufferData(GL_ARRAY_BUFFER, instanceDatas_.size() * sizeof(InstanceData), instanceDatas_.data(), GL_STATIC_DRAW);
+	instanceBuffer_.setData(instanceDatas_.data(), instanceDatas_.size() * sizeof(InstanceData));
+	glBindVertexArray(vao_);
 	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, color_));
 	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, modelMatrix_));
-	glEnableVertexAttribArray(3);
-	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, modelMatrix_) + 4 * sizeof(float)));
-	glEnableVertexAttribArray(4);
-	glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, modelMatrix_) + 8 * sizeof(float)));
-	glEnableVertexAttribArray(5);
-	glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, modelMatrix_) + 12 * sizeof(float)));
 	glVertexAttribDivisor(1, 1);
 	glVertexAttribDivisor(2, 1);
-	glVertexAttribDivisor(3, 1);
-	glVertexAttribDivisor(4, 1);
-	glVertexAttribDivisor(5, 1);
+	bindInstanceData(0);
+	glBindVertexArray(0);
+}
+
+void FieldRenderer::bindInstanceData(int firstInstance)
+{
+	// gl 3.3 has no base instance, so instance attributes are pointed at the
+	// first instance of each draw instead
+	const size_t offset = firstInstance * sizeof(InstanceData);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_.getHandle());
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, position_)));
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, velocity_)));
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
@@ -3,7 +3,9 @@
 
 #include <crius/velocityField/field3D/velocityField3D.h>
 
-VelocityField3D::VelocityField3D(QWidget* parent, RC<const VelocityField> velocityField)
+VelocityField3D::VelocityField3D(
+	QWidget* parent, RC<const VelocityField> velocityField,
+	RC<agz::thread::thread_group_t> threadGroup)
 	:QWidget(parent), velocityField_(velocityField)
 {
     auto layout = new QVBoxLayout(this);
@@ -38,14 +40,14 @@ VelocityField3D::VelocityField3D(QWidget* parent, RC<const VelocityField> veloci
     colorBar_->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Ignored);
     
     // openglwidget
-    openglWidget_ = new FieldRenderer(upPanel, velocityField_.get(), colorMapper_);
+    openglWidget_ = new FieldRenderer(upPanel, velocityField_.get(), colorMapper_, threadGroup);
     openglWidget_->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
     long sampleNum = openglWidget_->getSampleNums();
 
     // sample type
     auto velocitySampleText = new QLabel("Sample type", downPanel);
     velocitySampleType_ = new QComboBox(downPanel);
-    velocitySampleType_->addItems({ "random sample", "uniform sample", "halton sequence sample" });
+    velocitySampleType_->addItems({ "random sample", "uniform sample", "halton sequence sample", "importance sample" });
     velocitySampleType_->setCurrentIndex(0);
     velocitySampleText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
     
@@ -53,7 +55,7 @@ VelocityField3D::VelocityField3D(QWidget* parent, RC<const VelocityField> veloci
     auto velocityCountText = new QLabel(downPanel);
     auto velocityCountInput = new QSpinBox(downPanel);
     velocityCountText->setText("Sample count");
-    velocityCountInput->setRange(1, 10000);
+    velocityCountInput->setRange(1, 2000000);
     velocityCountInput->setValue(sampleNum);
     velocityCountText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     velocityCountInput->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Fixed);
@@ -165,6 +167,8 @@ VelocityField3D::VelocityField3D(QWidget* parent, RC<const VelocityField> veloci
                 openglWidget_->setSampleType(FieldRenderer::UNIFORMSAMPLE);
             else if(sampleType==2)
                 openglWidget_->setSampleType(FieldRenderer::HALTONSAMPLE);
+            else if(sampleType==3)
+                openglWidget_->setSampleType(FieldRenderer::IMPORTANCESAMPLE);
             openglWidget_->renderForReSample();
         });
 
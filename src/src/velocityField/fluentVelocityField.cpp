@@ -6,6 +6,17 @@
 
 #include <crius/velocityField/fluentVelocityField.h>
 
+namespace
+{
+
+    // number of finest bricks of the range pyramid along the longest axis
+    constexpr int RANGE_PYRAMID_RESOLUTION = 64;
+
+    // number of occupancy voxels along the longest axis
+    constexpr int OCCUPANCY_GRID_RESOLUTION = 64;
+
+} // namespace anonymous
+
 FluentVelocityField::FluentVelocityField(const std::string &filename)
 {
     reader_ = vtkSmartPointer<vtkFLUENTReader>::New();
@@ -41,6 +52,11 @@ FluentVelocityField::FluentVelocityField(const std::string &filename)
     maxVel_ = std::numeric_limits<float>::lowest();
     minVel_ = std::numeric_limits<float>::max();
 
+    auto rangePyramid = newRC<VelocityRangePyramid>(
+        getBoundingBox(), RANGE_PYRAMID_RESOLUTION);
+    auto occupancyGrid = newRC<OccupancyGrid>(
+        getBoundingBox(), OCCUPANCY_GRID_RESOLUTION);
+
     for(int i = 0; i < numCells; ++i)
     {
         const float x = static_cast<float>(velX_->GetValue(i));
@@ -58,7 +74,35 @@ FluentVelocityField::FluentVelocityField(const std::string &filename)
         const float len = std::sqrt(x * x + y * y + z * z);
         maxVel_ = (std::max)(maxVel_, len);
         minVel_ = (std::min)(minVel_, len);
+
+        double bounds[6];
+        dataSet_->GetCellBounds(i, bounds);
+        const AABB cellBound = {
+            {
+                static_cast<float>(bounds[0]),
+                static_cast<float>(bounds[2]),
+                static_cast<float>(bounds[4])
+            },
+            {
+                static_cast<float>(bounds[1]),
+                static_cast<float>(bounds[3]),
+                static_cast<float>(bounds[5])
+            }
+        };
+
+        rangePyramid->addCell(cellBound, Vec3(x, y, z));
+        occupancyGrid->addCell(cellBound);
     }
+
+    rangePyramid->build();
+    rangePyramid_ = std::move(rangePyramid);
+
+    occupancyGrid->classify([&](const Vec3 &pos)
+    {
+        double p[3] = { pos.x, pos.y, pos.z };
+        return cellLocator_->FindCell(p) >= 0;
+    });
+    occupancyGrid_ = std::move(occupancyGrid);
 }
 
 std::optional<Vec3> FluentVelocityField::getVelocity(
@@ -110,6 +154,24 @@ AABB FluentVelocityField::getBoundingBox() const noexcept
     };
 }
 
+std::optional<VelocityField::Range> FluentVelocityField::getVelocityRange(
+    const AABB &region, VelocityComponent component) const noexcept
+{
+    return rangePyramid_->query(region, component);
+}
+
+VelocityField::Occupancy FluentVelocityField::getOccupancy(
+    const Vec3 &pos) const noexcept
+{
+    return occupancyGrid_->getOccupancy(pos);
+}
+
+VelocityField::Occupancy FluentVelocityField::getOccupancy(
+    const AABB &region) const noexcept
+{
+    return occupancyGrid_->getOccupancy(region);
+}
+
 RC<VelocityField> FluentVelocityField::cloneForParallelAccess() const
 {
     auto ret = RC<FluentVelocityField>(new FluentVelocityField);
@@ -124,6 +186,9 @@ RC<VelocityField> FluentVelocityField::cloneForParallelAccess() const
     ret->velZ_      = velZ_;
     ret->dataSet_   = dataSet_;
 
+    ret->rangePyramid_  = rangePyramid_;
+    ret->occupancyGrid_ = occupancyGrid_;
+
     ret->cellLocator_ = vtkSmartPointer<vtkStaticCellLocator>::New();
     ret->cellLocator_->SetDataSet(dataSet_);
     ret->cellLocator_->BuildLocator();
@@ -2,6 +2,9 @@
 #include <crius/velocityField/field3D/velocityField3D.h>
 #include <crius/velocityField/fluentVelocityField.h>
 #include <crius/velocityField/fluentVelocityFieldVisualizer.h>
+#include <crius/velocityField/isosurface/velocityIsosurface.h>
+#include <crius/velocityField/streamline/velocityStreamline.h>
+#include <crius/velocityField/volume/velocityVolume.h>
 
 VelocityFieldVisualizer::VelocityFieldVisualizer(
     QWidget *parent,
@@ -13,6 +16,9 @@ VelocityFieldVisualizer::VelocityFieldVisualizer(
 
     menuBar()->addAction("Add Contour", [=] { addContourWindow(); });
     menuBar()->addAction("Add Field3D", [=] { add3DWindow(); });
+    menuBar()->addAction("Add Streamlines", [=] { addStreamlineWindow(); });
+    menuBar()->addAction("Add Volume", [=] { addVolumeWindow(); });
+    menuBar()->addAction("Add Isosurface", [=] { addIsosurfaceWindow(); });
     velocityField_ = newRC<FluentVelocityField>(fluentCaseFilename);
 
     threadGroup_.swap(threadGroup);
@@ -47,7 +53,7 @@ void VelocityFieldVisualizer::add3DWindow()
     CloseEventDockWidget* dock = new CloseEventDockWidget(this);
     dock->setWindowTitle(QString("Field"));
 
-    auto field3D = new VelocityField3D(dock, velocityField_);
+    auto field3D = new VelocityField3D(dock, velocityField_, threadGroup_);
     dock->setWidget(field3D);
 
     dock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
@@ -61,3 +67,64 @@ void VelocityFieldVisualizer::add3DWindow()
         delete dock;
     });
 }
+
+void VelocityFieldVisualizer::addStreamlineWindow()
+{
+    CloseEventDockWidget *dock = new CloseEventDockWidget(this);
+    dock->setWindowTitle(QString("Streamlines"));
+
+    auto streamline = new VelocityStreamline(
+        dock, velocityField_, threadGroup_);
+    dock->setWidget(streamline);
+
+    dock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
+    addDockWidget(Qt::RightDockWidgetArea, dock);
+
+    streamline->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+    dock->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+
+    connect(dock, &CloseEventDockWidget::closeSignal, [=]
+    {
+        delete dock;
+    });
+}
+
+void VelocityFieldVisualizer::addVolumeWindow()
+{
+    CloseEventDockWidget *dock = new CloseEventDockWidget(this);
+    dock->setWindowTitle(QString("Volume"));
+
+    auto volume = new VelocityVolume(dock, velocityField_, threadGroup_);
+    dock->setWidget(volume);
+
+    dock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
+    addDockWidget(Qt::RightDockWidgetArea, dock);
+
+    volume->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+    dock->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+
+    connect(dock, &CloseEventDockWidget::closeSignal, [=]
+    {
+        delete dock;
+    });
+}
+
+void VelocityFieldVisualizer::addIsosurfaceWindow()
+{
+    CloseEventDockWidget *dock = new CloseEventDockWidget(this);
+    dock->setWindowTitle(QString("Isosurface"));
+
+    auto isosurface = new VelocityIsosurface(dock, velocityField_, threadGroup_);
+    dock->setWidget(isosurface);
+
+    dock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
+    addDockWidget(Qt::RightDockWidgetArea, dock);
+
+    isosurface->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+    dock->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+
+    connect(dock, &CloseEventDockWidget::closeSignal, [=]
+    {
+        delete dock;
+    });
+}
@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include <crius/utility/parallelFor.h>
+#include <crius/velocityField/isosurface/isosurfaceExtractor.h>
+
+namespace
+{
+
+    // bricks have at most this many cubes along each axis
+    constexpr int BRICK_SIZE = 8;
+
+    // corner i of a cube is at offset (i & 1, (i >> 1) & 1, (i >> 2) & 1)
+    // from its lower corner. the six tetrahedra share the diagonal 0-7, so
+    // that faces of adjacent cubes are split the same way
+    constexpr int CUBE_TETRAHEDRA[6][4] = {
+        { 0, 1, 3, 7 },
+        { 0, 3, 2, 7 },
+        { 0, 2, 6, 7 },
+        { 0, 6, 4, 7 },
+        { 0, 4, 5, 7 },
+        { 0, 5, 1, 7 }
+    };
+
+    void polygonizeTetrahedron(
+        const Vec3         p[4],
+        const float        v[4],
+        float              isoValue,
+        std::vector<Vec3> &output)
+    {
+        int inside[4], outside[4];
+        int insideCount = 0, outsideCount = 0;
+        for(int i = 0; i < 4; ++i)
+        {
+            if(v[i] > isoValue)
+                inside[insideCount++] = i;
+            else
+                outside[outsideCount++] = i;
+        }
+
+        if(insideCount == 0 || insideCount == 4)
+            return;
+
+        auto edge = [&](int a, int b)
+        {
+            const float t = (isoValue - v[a]) / (v[b] - v[a]);
+            return p[a] + t * (p[b] - p[a]);
+        };
+
+        if(insideCount == 1)
+        {
+            output.push_back(edge(inside[0], outside[0]));
+            output.push_back(edge(inside[0], outside[1]));
+            output.push_back(edge(inside[0], outside[2]));
+        }
+        else if(insideCount == 3)
+        {
+            output.push_back(edge(outside[0], inside[0]));
+            output.push_back(edge(outside[0], inside[1]));
+            output.push_back(edge(outside[0], inside[2]));
+        }
+        else
+        {
+            // the four crossed edges form a quad in this order
+            const Vec3 a = edge(inside[0], outside[0]);
+            const Vec3 b = edge(inside[0], outside[1]);
+            const Vec3 c = edge(inside[1], outside[1]);
+            const Vec3 d = edge(inside[1], outside[0]);
+
+            output.push_back(a);
+            output.push_back(b);
+            output.push_back(c);
+
+            output.push_back(a);
+            output.push_back(c);
+            output.push_back(d);
+        }
+    }
+
+} // namespace anonymous
+
+IsosurfaceExtractor::IsosurfaceExtractor(
+    RC<const VelocityGrid>       grid,
+    agz::thread::thread_group_t &threadGroup)
+    : grid_(std::move(grid))
+{
+    const int cellCount   = grid_->getCellCount();
+    const int threadCount = agz::thread::actual_worker_count(-1);
+
+    values_.resize(cellCount);
+    parallelForBlocks(
+        threadGroup, threadCount, cellCount, 1 << 16,
+        [&](int, size_t beg, size_t end)
+    {
+        for(size_t i = beg; i < end; ++i)
+        {
+            const int cell = static_cast<int>(i);
+            values_[i] = grid_->isValid(cell) ?
+                grid_->getVelocity(cell).length() :
+                std::numeric_limits<float>::quiet_NaN();
+        }
+    });
+
+    minValue_ = 0;
+    maxValue_ = grid_->getMaxSpeed();
+
+    // split cubes into bricks
+
+    const Vec3i &res = grid_->getResolution();
+    const Vec3i cubeRes(
+        (std::max)(res.x - 1, 0),
+        (std::max)(res.y - 1, 0),
+        (std::max)(res.z - 1, 0));
+
+    for(int z = 0; z < cubeRes.z; z += BRICK_SIZE)
+    {
+        for(int y = 0; y < cubeRes.y; y += BRICK_SIZE)
+        {
+            for(int x = 0; x < cubeRes.x; x += BRICK_SIZE)
+            {
+                Brick brick;
+                brick.lower = Vec3i(x, y, z);
+                brick.upper = Vec3i(
+                    (std::min)(x + BRICK_SIZE, cubeRes.x),
+                    (std::min)(y + BRICK_SIZE, cubeRes.y),
+                    (std::min)(z + BRICK_SIZE, cubeRes.z));
+                bricks_.push_back(std::move(brick));
+            }
+        }
+    }
+
+    // value range of each brick over its cube corners. bricks without
+    // valid cells get an empty range
+
+    parallelForBlocks(
+        threadGroup, threadCount, bricks_.size(), 1,
+        [&](int, size_t beg, size_t end)
+    {
+        for(size_t i = beg; i < end; ++i)
+        {
+            Brick &brick = bricks_[i];
+
+            float minValue = (std::numeric_limits<float>::max)();
+            float maxValue = std::numeric_limits<float>::lowest();
+            for(int z = brick.lower.z; z <= brick.upper.z; ++z)
+            {
+                for(int y = brick.lower.y; y <= brick.upper.y; ++y)
+                {
+                    for(int x = brick.lower.x; x <= brick.upper.x; ++x)
+                    {
+                        const float value = values_[grid_->getCellIndex(x, y, z)];
+                        if(!std::isnan(value))
+                        {
+                            minValue = (std::min)(minValue, value);
+                            maxValue = (std::max)(maxValue, value);
+                        }
+                    }
+                }
+            }
+
+            brick.minValue = minValue;
+            brick.maxValue = maxValue;
+        }
+    });
+}
+
+const VelocityGrid &IsosurfaceExtractor::getGrid() const noexcept
+{
+    return *grid_;
+}
+
+float IsosurfaceExtractor::getMinValue() const noexcept
+{
+    return minValue_;
+}
+
+float IsosurfaceExtractor::getMaxValue() const noexcept
+{
+    return maxValue_;
+}
+
+const std::vector<Vec3> &IsosurfaceExtractor::extract(
+    float                        isoValue,
+    agz::thread::thread_group_t &threadGroup,
+    Stats                       *stats)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    const int threadCount = agz::thread::actual_worker_count(-1);
+
+    std::vector<int> visitedBricks;
+    for(size_t i = 0; i < bricks_.size(); ++i)
+    {
+        const Brick &brick = bricks_[i];
+        if(brick.minValue <= isoValue && isoValue <= brick.maxValue)
+            visitedBricks.push_back(static_cast<int>(i));
+    }
+
+    // each visited brick is handled by one thread and writes its own
+    // vertex array, so no synchronization is needed
+
+    parallelForBlocks(
+        threadGroup, threadCount, visitedBricks.size(), 1,
+        [&](int, size_t beg, size_t end)
+    {
+        for(size_t i = beg; i < end; ++i)
+        {
+            Brick &brick = bricks_[visitedBricks[i]];
+            if(!brick.isIntervalTreeBuilt)
+            {
+                buildIntervalTree(brick);
+                brick.isIntervalTreeBuilt = true;
+            }
+            extractBrick(brick, isoValue);
+        }
+    });
+
+    // concatenate brick outputs at prefix sum offsets
+
+    std::vector<size_t> offsets(visitedBricks.size() + 1, 0);
+    for(size_t i = 0; i < visitedBricks.size(); ++i)
+        offsets[i + 1] = offsets[i] + bricks_[visitedBricks[i]].vertices.size();
+
+    vertices_.resize(offsets.back());
+    parallelForBlocks(
+        threadGroup, threadCount, visitedBricks.size(), 1,
+        [&](int, size_t beg, size_t end)
+    {
+        for(size_t i = beg; i < end; ++i)
+        {
+            const std::vector<Vec3> &src = bricks_[visitedBricks[i]].vertices;
+            std::copy(src.begin(), src.end(), vertices_.begin() + offsets[i]);
+        }
+    });
+
+    if(stats)
+    {
+        stats->brickCount        = static_cast<int>(bricks_.size());
+        stats->visitedBrickCount = static_cast<int>(visitedBricks.size());
+        stats->triangleCount     = static_cast<int>(vertices_.size() / 3);
+        stats->seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    return vertices_;
+}
+
+void IsosurfaceExtractor::buildIntervalTree(Brick &brick) const
+{
+    // cubes with an invalid corner are left out
+
+    std::vector<ActiveCube> cubes;
+    for(int z = brick.lower.z; z < brick.upper.z; ++z)
+    {
+        for(int y = brick.lower.y; y < brick.upper.y; ++y)
+        {
+            for(int x = brick.lower.x; x < brick.upper.x; ++x)
+            {
+                float minValue = (std::numeric_limits<float>::max)();
+                float maxValue = std::numeric_limits<float>::lowest();
+                bool isValid = true;
+
+                for(int c = 0; c < 8 && isValid; ++c)
+                {
+                    const float value = values_[grid_->getCellIndex(
+                        x + (c & 1), y + ((c >> 1) & 1), z + ((c >> 2) & 1))];
+                    isValid = !std::isnan(value);
+                    minValue = (std::min)(minValue, value);
+                    maxValue = (std::max)(maxValue, value);
+                }
+
+                if(isValid)
+                {
+                    cubes.push_back(
+                        { grid_->getCellIndex(x, y, z), minValue, maxValue });
+                }
+            }
+        }
+    }
+
+    brick.cubesByMin.reserve(cubes.size());
+    brick.cubesByMax.reserve(cubes.size());
+    buildIntervalNode(brick, std::move(cubes));
+}
+
+int IsosurfaceExtractor::buildIntervalNode(
+    Brick &brick, std::vector<ActiveCube> cubes)
+{
+    if(cubes.empty())
+        return -1;
+
+    // the median of range midpoints is contained by the range of its own
+    // cube, so every node stores at least one cube
+
+    const auto midpoint = [](const ActiveCube &cube)
+    {
+        return 0.5f * (cube.minValue + cube.maxValue);
+    };
+
+    const auto median = cubes.begin() + cubes.size() / 2;
+    std::nth_element(
+        cubes.begin(), median, cubes.end(),
+        [&](const ActiveCube &a, const ActiveCube &b)
+    {
+        return midpoint(a) < midpoint(b);
+    });
+    const float center = midpoint(*median);
+
+    std::vector<ActiveCube> leftCubes, rightCubes, centerCubes;
+    for(const ActiveCube &cube : cubes)
+    {
+        if(cube.maxValue < center)
+            leftCubes.push_back(cube);
+        else if(cube.minValue > center)
+            rightCubes.push_back(cube);
+        else
+            centerCubes.push_back(cube);
+    }
+
+    const int nodeIndex = static_cast<int>(brick.nodes.size());
+    const int beg = static_cast<int>(brick.cubesByMin.size());
+    brick.nodes.push_back(
+        { center, -1, -1, beg, beg + static_cast<int>(centerCubes.size()) });
+
+    std::sort(
+        centerCubes.begin(), centerCubes.end(),
+        [](const ActiveCube &a, const ActiveCube &b)
+    {
+        return a.minValue < b.minValue;
+    });
+    brick.cubesByMin.insert(
+        brick.cubesByMin.end(), centerCubes.begin(), centerCubes.end());
+
+    std::sort(
+        centerCubes.begin(), centerCubes.end(),
+        [](const ActiveCube &a, const ActiveCube &b)
+    {
+        return a.maxValue > b.maxValue;
+    });
+    brick.cubesByMax.insert(
+        brick.cubesByMax.end(), centerCubes.begin(), centerCubes.end());
+
+    const int left  = buildIntervalNode(brick, std::move(leftCubes));
+    const int right = buildIntervalNode(brick, std::move(rightCubes));
+    brick.nodes[nodeIndex].left  = left;
+    brick.nodes[nodeIndex].right = right;
+
+    return nodeIndex;
+}
+
+void IsosurfaceExtractor::extractBrick(Brick &brick, float isoValue) const
+{
+    brick.vertices.clear();
+
+    // walk down one path of the interval tree. below the center of a node,
+    // its cubes with min not above the iso value are exactly the crossed
+    // ones, which form a prefix of cubesByMin. above the center, crossed
+    // cubes form a prefix of cubesByMax
+
+    int nodeIndex = brick.nodes.empty() ? -1 : 0;
+    while(nodeIndex >= 0)
+    {
+        const IntervalNode &node = brick.nodes[nodeIndex];
+
+        if(isoValue < node.center)
+        {
+            for(int i = node.beg; i < node.end; ++i)
+            {
+                const ActiveCube &cube = brick.cubesByMin[i];
+                if(cube.minValue > isoValue)
+                    break;
+                polygonizeCube(cube, isoValue, brick.vertices);
+            }
+            nodeIndex = node.left;
+        }
+        else if(isoValue > node.center)
+        {
+            for(int i = node.beg; i < node.end; ++i)
+            {
+                const ActiveCube &cube = brick.cubesByMax[i];
+                if(cube.maxValue < isoValue)
+                    break;
+                polygonizeCube(cube, isoValue, brick.vertices);
+            }
+            nodeIndex = node.right;
+        }
+        else
+        {
+            for(int i = node.beg; i < node.end; ++i)
+                polygonizeCube(brick.cubesByMin[i], isoValue, brick.vertices);
+            nodeIndex = -1;
+        }
+    }
+}
+
+void IsosurfaceExtractor::polygonizeCube(
+    const ActiveCube &cube, float isoValue, std::vector<Vec3> &output) const
+{
+    const Vec3i &res = grid_->getResolution();
+
+    const int x = cube.cell % res.x;
+    const int y = (cube.cell / res.x) % res.y;
+    const int z = cube.cell / (res.x * res.y);
+
+    Vec3  p[8];
+    float v[8];
+    for(int c = 0; c < 8; ++c)
+    {
+        const int cx = x + (c & 1);
+        const int cy = y + ((c >> 1) & 1);
+        const int cz = z + ((c >> 2) & 1);
+        p[c] = grid_->getCellCenter(cx, cy, cz);
+        v[c] = values_[grid_->getCellIndex(cx, cy, cz)];
+    }
+
+    for(auto &tet : CUBE_TETRAHEDRA)
+    {
+        const Vec3  tp[4] = { p[tet[0]], p[tet[1]], p[tet[2]], p[tet[3]] };
+        const float tv[4] = { v[tet[0]], v[tet[1]], v[tet[2]], v[tet[3]] };
+        polygonizeTetrahedron(tp, tv, isoValue, output);
+    }
+}
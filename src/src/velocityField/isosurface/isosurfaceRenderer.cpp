@@ -0,0 +1,267 @@
+#include <cmath>
+
+#include <QMatrix4x4>
+#include <QMouseEvent>
+#include <QSurfaceFormat>
+
+#include <crius/velocityField/isosurface/isosurfaceRenderer.h>
+
+namespace
+{
+
+    const char SURFACE_VS[] = R"___(
+    #version 330 core
+
+    uniform mat4 projView;
+
+    layout(location = 0) in vec3 iPosition;
+
+    out vec3 worldPos;
+
+    void main()
+    {
+        worldPos = iPosition;
+        gl_Position = projView * vec4(iPosition, 1);
+    }
+    )___";
+
+    const char SURFACE_FS[] = R"___(
+    #version 330 core
+
+    uniform vec3 eye;
+    uniform vec3 color;
+
+    in vec3 worldPos;
+
+    out vec4 fragColor;
+
+    void main()
+    {
+        vec3 nor = normalize(cross(dFdx(worldPos), dFdy(worldPos)));
+        float lambert = abs(dot(nor, normalize(eye - worldPos)));
+        fragColor = vec4(color * (0.2 + 0.8 * lambert), 1);
+    }
+    )___";
+
+    constexpr float PERSPECTIVE_FOV_DEG = 40.0f;
+
+} // namespace anonymous
+
+IsosurfaceRenderer::IsosurfaceRenderer(QWidget *parent, const AABB &boundingBox)
+    : QOpenGLWidget(parent), boundingBox_(boundingBox)
+{
+    QSurfaceFormat format;
+    format.setMajorVersion(3);
+    format.setMinorVersion(3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+#ifdef AGZ_DEBUG
+    format.setOption(QSurfaceFormat::DebugContext);
+#endif
+    setFormat(format);
+
+    useDefaultCamera();
+}
+
+IsosurfaceRenderer::~IsosurfaceRenderer()
+{
+    makeCurrent();
+
+    if(vao_)
+        glDeleteVertexArrays(1, &vao_);
+    vertexBuffer_.destroy();
+
+    doneCurrent();
+}
+
+void IsosurfaceRenderer::setSurface(const std::vector<Vec3> &vertices)
+{
+    pendingVertices_ = vertices;
+    isSurfaceDirty_ = true;
+    update();
+}
+
+void IsosurfaceRenderer::setColor(const QColor &color)
+{
+    color_ = Vec3(color.redF(), color.greenF(), color.blueF());
+    update();
+}
+
+void IsosurfaceRenderer::useDefaultCamera()
+{
+    horiRad_  = 0;
+    vertRad_  = 0;
+    distance_ = 1.1f * distance(boundingBox_.lower, boundingBox_.upper);
+    lookAt_   = 0.5f * (boundingBox_.lower + boundingBox_.upper);
+    update();
+}
+
+void IsosurfaceRenderer::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    surfaceShader_.addShaderFromSourceCode(QOpenGLShader::Vertex, SURFACE_VS);
+    surfaceShader_.addShaderFromSourceCode(QOpenGLShader::Fragment, SURFACE_FS);
+    surfaceShader_.link();
+
+    // the buffer keeps its name when the surface is replaced, so the vao
+    // is set up once
+    vertexBuffer_.create(this);
+
+    glGenVertexArrays(1, &vao_);
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer_.getHandle());
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vec3), nullptr);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    glEnable(GL_DEPTH_TEST);
+}
+
+void IsosurfaceRenderer::paintGL()
+{
+    if(isSurfaceDirty_)
+    {
+        vertexBuffer_.setData(
+            pendingVertices_.data(), sizeof(Vec3) * pendingVertices_.size());
+        vertexCount_ = static_cast<int>(pendingVertices_.size());
+
+        pendingVertices_.clear();
+        pendingVertices_.shrink_to_fit();
+        isSurfaceDirty_ = false;
+    }
+
+    glClearColor(0, 0.3f, 0.3f, 0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    if(!vertexCount_)
+        return;
+
+    const Vec3 dir = {
+        std::cos(vertRad_) * std::cos(horiRad_),
+        std::sin(vertRad_),
+        std::cos(vertRad_) * std::sin(horiRad_)
+    };
+    const Vec3 eye = lookAt_ - dir * distance_;
+
+    QMatrix4x4 view, proj;
+    view.lookAt(
+        QVector3D(eye.x, eye.y, eye.z),
+        QVector3D(lookAt_.x, lookAt_.y, lookAt_.z),
+        QVector3D(0, 1, 0));
+    proj.perspective(
+        PERSPECTIVE_FOV_DEG, static_cast<float>(width()) / height(),
+        0.01f * distance_, 100 * distance_);
+
+    surfaceShader_.bind();
+    surfaceShader_.setUniformValue(
+        surfaceShader_.uniformLocation("projView"), proj * view);
+    surfaceShader_.setUniformValue(
+        surfaceShader_.uniformLocation("eye"), QVector3D(eye.x, eye.y, eye.z));
+    surfaceShader_.setUniformValue(
+        surfaceShader_.uniformLocation("color"),
+        QVector3D(color_.x, color_.y, color_.z));
+
+    glBindVertexArray(vao_);
+    glDrawArrays(GL_TRIANGLES, 0, vertexCount_);
+    glBindVertexArray(0);
+
+    surfaceShader_.release();
+}
+
+float IsosurfaceRenderer::getPixelToWorldScale() const noexcept
+{
+    return distance_ * 2
+         * std::tan(agz::math::deg2rad(PERSPECTIVE_FOV_DEG) / 2) / height();
+}
+
+void IsosurfaceRenderer::mousePressEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::RightButton)
+    {
+        lastRightPressX_ = event->x();
+        lastRightPressY_ = event->y();
+        rightPressed_ = true;
+    }
+    else if(event->button() == Qt::MiddleButton)
+    {
+        lastMiddlePressX_ = event->x();
+        lastMiddlePressY_ = event->y();
+        middlePressed_ = true;
+    }
+}
+
+void IsosurfaceRenderer::mouseReleaseEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::RightButton)
+        rightPressed_ = false;
+    else if(event->button() == Qt::MiddleButton)
+        middlePressed_ = false;
+}
+
+void IsosurfaceRenderer::mouseMoveEvent(QMouseEvent *event)
+{
+    if(rightPressed_)
+    {
+        constexpr float PI = agz::math::PI_f;
+
+        const int dx = event->x() - lastRightPressX_;
+        const int dy = event->y() - lastRightPressY_;
+        lastRightPressX_ = event->x();
+        lastRightPressY_ = event->y();
+
+        vertRad_ = agz::math::clamp(
+            vertRad_ - 0.003f * dy, -PI / 2 + 0.01f, PI / 2 - 0.01f);
+        horiRad_ -= 0.003f * dx;
+
+        update();
+    }
+    else if(middlePressed_)
+    {
+        const int dx = event->x() - lastMiddlePressX_;
+        const int dy = event->y() - lastMiddlePressY_;
+        lastMiddlePressX_ = event->x();
+        lastMiddlePressY_ = event->y();
+
+        const float pixelToWorldScale = getPixelToWorldScale();
+
+        const Vec3 dir = {
+            std::cos(vertRad_) * std::cos(horiRad_),
+            std::sin(vertRad_),
+            std::cos(vertRad_) * std::sin(horiRad_)
+        };
+        const Vec3 ex = cross(dir, Vec3(0, 1, 0)).normalize();
+        const Vec3 ey = cross(ex, dir);
+
+        lookAt_ += dx * pixelToWorldScale * ex + dy * pixelToWorldScale * ey;
+
+        update();
+    }
+}
+
+void IsosurfaceRenderer::leaveEvent(QEvent *event)
+{
+    rightPressed_ = false;
+    middlePressed_ = false;
+}
+
+void IsosurfaceRenderer::wheelEvent(QWheelEvent *event)
+{
+    const int dZ = event->angleDelta().y();
+
+    if(dZ > 0)
+    {
+        for(int i = 0; i < dZ; i += 120)
+            distance_ *= 0.90909f;
+    }
+    else
+    {
+        for(int i = 0; i > dZ; i -= 120)
+            distance_ *= 1.1f;
+    }
+
+    distance_ = (std::max)(
+        distance_, 0.05f * distance(boundingBox_.lower, boundingBox_.upper));
+
+    update();
+}
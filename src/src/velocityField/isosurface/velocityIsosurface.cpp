@@ -0,0 +1,142 @@
+#include <QGridLayout>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+#include <crius/velocityField/isosurface/velocityIsosurface.h>
+
+namespace
+{
+
+    // grid resolutions along the longest axis of the field
+    constexpr int RESOLUTIONS[] = { 64, 128, 256 };
+
+} // namespace anonymous
+
+VelocityIsosurface::VelocityIsosurface(
+    QWidget                        *parent,
+    RC<const VelocityField>         velocityField,
+    RC<agz::thread::thread_group_t> threadGroup)
+    : QWidget(parent),
+      velocityField_(std::move(velocityField)),
+      threadGroup_(std::move(threadGroup))
+{
+    auto layout     = new QVBoxLayout(this);
+    auto upPanel    = new QFrame(this);
+    auto downPanel  = new QFrame(this);
+    auto upLayout   = new QHBoxLayout(upPanel);
+    auto downLayout = new QGridLayout(downPanel);
+
+    upPanel->setFrameShape(QFrame::Box);
+    downPanel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+
+    layout->addWidget(upPanel);
+    layout->addWidget(downPanel);
+
+    auto resolutionText = new QLabel("Resolution", downPanel);
+    auto isoValueText   = new QLabel("Iso Velocity", downPanel);
+
+    resolution_ = new QComboBox(downPanel);
+    isoValue_   = new DoubleSlider(downPanel);
+    stats_      = new QLabel(downPanel);
+
+    resolution_->addItems({ "64", "128", "256" });
+    resolution_->setCurrentIndex(1);
+
+    resolutionText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    isoValueText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+
+    // color mapper & color bar
+
+    colorMapper_ = new HSVColorMapper(downPanel);
+    colorMapper_->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
+
+    colorBar_ = new ColorBar(upPanel, colorMapper_);
+    colorBar_->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Ignored);
+
+    // renderer
+
+    renderer_ = new IsosurfaceRenderer(
+        upPanel, velocityField_->getBoundingBox());
+    renderer_->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+
+    auto useDefaultCamera = new QPushButton("Use default camera", downPanel);
+
+    upLayout->addWidget(colorBar_);
+    upLayout->addWidget(renderer_);
+
+    downLayout->addWidget(resolutionText,   0, 0, 1, 1);
+    downLayout->addWidget(resolution_,      0, 1, 1, 1);
+    downLayout->addWidget(isoValueText,     1, 0, 1, 1);
+    downLayout->addWidget(isoValue_,        1, 1, 1, 1);
+    downLayout->addWidget(stats_,           2, 0, 1, 2);
+    downLayout->addWidget(useDefaultCamera, 3, 0, 1, 2);
+    downLayout->addWidget(colorMapper_,     0, 2, 4, 1);
+
+    createExtractor();
+
+    connect(resolution_, qOverload<int>(&QComboBox::currentIndexChanged),
+            [this](int)
+    {
+        createExtractor();
+    });
+
+    connect(isoValue_, &DoubleSlider::changingValue,
+            [this]
+    {
+        extractSurface();
+        updateSurfaceColor();
+    });
+
+    connect(useDefaultCamera, &QPushButton::clicked,
+            [this](bool)
+    {
+        renderer_->useDefaultCamera();
+    });
+
+    connect(colorMapper_, &VelocityColorMapper::editParams,
+            [this]
+    {
+        colorBar_->redraw();
+        updateSurfaceColor();
+    });
+}
+
+void VelocityIsosurface::createExtractor()
+{
+    auto grid = newRC<VelocityGrid>(
+        *velocityField_, RESOLUTIONS[resolution_->currentIndex()],
+        *threadGroup_);
+    extractor_ = newRC<IsosurfaceExtractor>(
+        std::move(grid), *threadGroup_);
+
+    const float minValue = extractor_->getMinValue();
+    const float maxValue = (std::max)(extractor_->getMaxValue(), 1e-20f);
+
+    isoValue_->setRange(minValue, maxValue);
+    isoValue_->setValue(0.5f * (minValue + maxValue));
+
+    colorMapper_->setVelocityRange(minValue, maxValue);
+    colorBar_->setParams(minValue, maxValue);
+
+    extractSurface();
+    updateSurfaceColor();
+}
+
+void VelocityIsosurface::extractSurface()
+{
+    IsosurfaceExtractor::Stats stats;
+    renderer_->setSurface(extractor_->extract(
+        static_cast<float>(isoValue_->getValue()), *threadGroup_, &stats));
+
+    stats_->setText(QString("%1 triangles, %2 / %3 bricks visited, %4 ms")
+        .arg(stats.triangleCount)
+        .arg(stats.visitedBrickCount)
+        .arg(stats.brickCount)
+        .arg(stats.seconds * 1000, 0, 'f', 1));
+}
+
+void VelocityIsosurface::updateSurfaceColor()
+{
+    renderer_->setColor(colorMapper_->getColor(
+        static_cast<float>(isoValue_->getValue())));
+}
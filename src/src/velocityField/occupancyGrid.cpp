@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cmath>
+
+#include <crius/velocityField/occupancyGrid.h>
+
+using Occupancy = VelocityField::Occupancy;
+
+namespace
+{
+
+    // cell bounds are grown by this fraction of a voxel before splatting, so
+    // that cells touching a voxel face count as overlapping it
+    constexpr float CELL_BOUND_EPSILON = 1e-3f;
+
+    // state of a voxel overlapped by some cell before classification
+    constexpr Occupancy OVERLAPPED = Occupancy::Boundary;
+
+} // namespace anonymous
+
+OccupancyGrid::OccupancyGrid(const AABB &bound, int maxResolution)
+    : bound_(bound)
+{
+    const Vec3 extent = bound_.upper - bound_.lower;
+    const float maxExtent = (std::max)(
+        (std::max)(extent.x, extent.y), (std::max)(extent.z, 1e-20f));
+    const auto axisResolution = [&](float axisExtent)
+    {
+        return (std::max)(1, static_cast<int>(
+            std::ceil(maxResolution * axisExtent / maxExtent)));
+    };
+
+    res_ = Vec3i(
+        axisResolution(extent.x),
+        axisResolution(extent.y),
+        axisResolution(extent.z));
+
+    // a flat axis, e.g. z of a 2d case, gets a tiny positive voxel size so
+    // that coordinates can be divided by it
+    voxelSize_ = Vec3(
+        (std::max)(extent.x, 1e-20f),
+        (std::max)(extent.y, 1e-20f),
+        (std::max)(extent.z, 1e-20f)) / Vec3(
+        static_cast<float>(res_.x),
+        static_cast<float>(res_.y),
+        static_cast<float>(res_.z));
+
+    voxels_.resize(
+        static_cast<size_t>(res_.x) * res_.y * res_.z, Occupancy::Outside);
+}
+
+void OccupancyGrid::addCell(const AABB &cellBound) noexcept
+{
+    int lower[3], upper[3];
+    for(int i = 0; i < 3; ++i)
+    {
+        const float eps = CELL_BOUND_EPSILON * voxelSize_[i];
+        lower[i] = getAxisVoxel(i, cellBound.lower[i] - eps);
+        upper[i] = getAxisVoxel(i, cellBound.upper[i] + eps);
+    }
+
+    for(int z = lower[2]; z <= upper[2]; ++z)
+    {
+        for(int y = lower[1]; y <= upper[1]; ++y)
+        {
+            for(int x = lower[0]; x <= upper[0]; ++x)
+                voxels_[getVoxelIndex(x, y, z)] = OVERLAPPED;
+        }
+    }
+}
+
+void OccupancyGrid::classify(const std::function<bool(const Vec3 &)> &isDefined)
+{
+    // corners are shared by up to eight voxels, so their results are cached.
+    // -1 means not tested yet
+
+    const Vec3i latticeRes = res_ + Vec3i(1);
+    std::vector<int8_t> corners(
+        static_cast<size_t>(latticeRes.x) * latticeRes.y * latticeRes.z, -1);
+
+    const auto isCornerDefined = [&](int x, int y, int z)
+    {
+        int8_t &corner = corners[x + latticeRes.x * (y + latticeRes.y * z)];
+        if(corner < 0)
+        {
+            corner = isDefined(bound_.lower + voxelSize_ * Vec3(
+                static_cast<float>(x),
+                static_cast<float>(y),
+                static_cast<float>(z)));
+        }
+        return corner != 0;
+    };
+
+    for(int z = 0; z < res_.z; ++z)
+    {
+        for(int y = 0; y < res_.y; ++y)
+        {
+            for(int x = 0; x < res_.x; ++x)
+            {
+                Occupancy &voxel = voxels_[getVoxelIndex(x, y, z)];
+                if(voxel != OVERLAPPED)
+                    continue;
+
+                bool isInside = isDefined(bound_.lower + voxelSize_ * Vec3(
+                    x + 0.5f, y + 0.5f, z + 0.5f));
+                for(int c = 0; c < 8 && isInside; ++c)
+                {
+                    isInside = isCornerDefined(
+                        x + (c & 1), y + ((c >> 1) & 1), z + ((c >> 2) & 1));
+                }
+
+                voxel = isInside ? Occupancy::Inside : Occupancy::Boundary;
+            }
+        }
+    }
+}
+
+Occupancy OccupancyGrid::getOccupancy(const Vec3 &pos) const noexcept
+{
+    for(int i = 0; i < 3; ++i)
+    {
+        if(pos[i] < bound_.lower[i] || bound_.upper[i] < pos[i])
+            return Occupancy::Outside;
+    }
+
+    return voxels_[getVoxelIndex(
+        getAxisVoxel(0, pos.x), getAxisVoxel(1, pos.y), getAxisVoxel(2, pos.z))];
+}
+
+Occupancy OccupancyGrid::getOccupancy(const AABB &region) const noexcept
+{
+    // parts of the region outside the bounding box are Outside
+
+    bool isClipped = false;
+    for(int i = 0; i < 3; ++i)
+    {
+        if(region.upper[i] < bound_.lower[i] || bound_.upper[i] < region.lower[i])
+            return Occupancy::Outside;
+        if(region.lower[i] < bound_.lower[i] || bound_.upper[i] < region.upper[i])
+            isClipped = true;
+    }
+
+    int lower[3], upper[3];
+    for(int i = 0; i < 3; ++i)
+    {
+        lower[i] = getAxisVoxel(i, region.lower[i]);
+        upper[i] = getAxisVoxel(i, region.upper[i]);
+    }
+
+    bool hasOutside = isClipped;
+    bool hasInside  = false;
+    for(int z = lower[2]; z <= upper[2]; ++z)
+    {
+        for(int y = lower[1]; y <= upper[1]; ++y)
+        {
+            for(int x = lower[0]; x <= upper[0]; ++x)
+            {
+                const Occupancy voxel = voxels_[getVoxelIndex(x, y, z)];
+                if(voxel == Occupancy::Boundary)
+                    return Occupancy::Boundary;
+
+                hasOutside |= voxel == Occupancy::Outside;
+                hasInside  |= voxel == Occupancy::Inside;
+                if(hasOutside && hasInside)
+                    return Occupancy::Boundary;
+            }
+        }
+    }
+
+    return hasInside ? Occupancy::Inside : Occupancy::Outside;
+}
+
+int OccupancyGrid::getVoxelIndex(int x, int y, int z) const noexcept
+{
+    return x + res_.x * (y + res_.y * z);
+}
+
+int OccupancyGrid::getAxisVoxel(int axis, float coord) const noexcept
+{
+    // clamped before the cast, which would be undefined for values out of
+    // the int range
+    return static_cast<int>(agz::math::clamp(
+        std::floor((coord - bound_.lower[axis]) / voxelSize_[axis]),
+        0.0f, static_cast<float>(res_[axis] - 1)));
+}
@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include <crius/utility/parallelFor.h>
+#include <crius/velocityField/streamline/streamlineTracer.h>
+
+namespace
+{
+
+    // dormand-prince 5(4) tableau. the last stage is evaluated at the 5th
+    // order solution, so it is reused as the first stage of the next step
+
+    constexpr float DP_A[6][6] = {
+        { 1.0f / 5 },
+        { 3.0f / 40, 9.0f / 40 },
+        { 44.0f / 45, -56.0f / 15, 32.0f / 9 },
+        { 19372.0f / 6561, -25360.0f / 2187, 64448.0f / 6561, -212.0f / 729 },
+        { 9017.0f / 3168, -355.0f / 33, 46732.0f / 5247, 49.0f / 176,
+          -5103.0f / 18656 },
+        { 35.0f / 384, 0, 500.0f / 1113, 125.0f / 192, -2187.0f / 6784,
+          11.0f / 84 }
+    };
+
+    // difference between 5th and 4th order weights
+    constexpr float DP_E[7] = {
+        71.0f / 57600, 0, -71.0f / 16695, 71.0f / 1920, -17253.0f / 339200,
+        22.0f / 525, -1.0f / 40
+    };
+
+    // bounds of the step length change after an adaptive step
+    constexpr float MIN_STEP_FACTOR = 0.2f;
+    constexpr float MAX_STEP_FACTOR = 5.0f;
+
+    // seeds are handed out to workers in blocks of this size
+    constexpr size_t SEED_BLOCK_SIZE = 16;
+
+    // integrates dx/dt = sign * v(x), with sign being -1 when tracing upstream
+    class DirectionalField
+    {
+    public:
+
+        DirectionalField(const VelocityField &field, float sign) noexcept
+            : field_(field), sign_(sign)
+        {
+
+        }
+
+        bool evaluate(const Vec3 &pos, Vec3 *vel) const noexcept
+        {
+            const auto v = field_.getVelocity(pos);
+            if(!v)
+                return false;
+            *vel = sign_ * *v;
+            return true;
+        }
+
+    private:
+
+        const VelocityField &field_;
+        float sign_;
+    };
+
+    // append points after the seed to positions and times
+    void traceRK4(
+        const DirectionalField        &field,
+        const StreamlineTracingParams &params,
+        float                          sign,
+        const Vec3                    &seed,
+        const Vec3                    &seedVelocity,
+        std::vector<Vec3>             &positions,
+        std::vector<float>            &times)
+    {
+        Vec3 p = seed, v = seedVelocity;
+        float t = 0, length = 0;
+
+        for(int n = 0; n < params.maxPointCount && length < params.maxLength; ++n)
+        {
+            const float speed = v.length();
+            if(speed < params.minSpeed)
+                return;
+            const float dt = params.stepLength / speed;
+
+            Vec3 k2, k3, k4, nextV;
+            if(!field.evaluate(p + 0.5f * dt * v, &k2) ||
+               !field.evaluate(p + 0.5f * dt * k2, &k3) ||
+               !field.evaluate(p + dt * k3, &k4))
+                return;
+
+            const Vec3 next = p + dt / 6 * (v + 2.0f * k2 + 2.0f * k3 + k4);
+            if(!field.evaluate(next, &nextV))
+                return;
+
+            length += distance(p, next);
+            t += dt;
+            p = next;
+            v = nextV;
+
+            positions.push_back(p);
+            times.push_back(sign * t);
+        }
+    }
+
+    void traceRK45(
+        const DirectionalField        &field,
+        const StreamlineTracingParams &params,
+        float                          sign,
+        const Vec3                    &seed,
+        const Vec3                    &seedVelocity,
+        std::vector<Vec3>             &positions,
+        std::vector<float>            &times)
+    {
+        // the step is controlled by its length h rather than its duration, so
+        // that slow and fast regions get similar spatial resolution
+
+        Vec3 p = seed, k[7];
+        k[0] = seedVelocity;
+        float t = 0, length = 0;
+        float h = params.stepLength;
+
+        int pointCount = 0;
+        while(pointCount < params.maxPointCount && length < params.maxLength)
+        {
+            const float speed = k[0].length();
+            if(speed < params.minSpeed)
+                return;
+
+            h = agz::math::clamp(h, params.minStepLength, params.maxStepLength);
+            const float dt = h / speed;
+
+            bool inside = true;
+            for(int s = 1; s < 7 && inside; ++s)
+            {
+                Vec3 q = p;
+                for(int j = 0; j < s; ++j)
+                    q += dt * DP_A[s - 1][j] * k[j];
+                inside = field.evaluate(q, &k[s]);
+            }
+
+            // a step partly outside of the field is retried with a shorter
+            // length, until it reaches the minimum length
+
+            if(!inside)
+            {
+                if(h <= params.minStepLength)
+                    return;
+                h = (std::max)(0.5f * h, params.minStepLength);
+                continue;
+            }
+
+            // the 5th order solution is the last evaluated stage point
+            Vec3 next = p, err(0);
+            for(int s = 0; s < 6; ++s)
+                next += dt * DP_A[5][s] * k[s];
+            for(int s = 0; s < 7; ++s)
+                err += dt * DP_E[s] * k[s];
+
+            const float errLen = err.length();
+            const float factor = agz::math::clamp(
+                0.9f * std::pow(params.tolerance / (std::max)(errLen, 1e-20f), 0.2f),
+                MIN_STEP_FACTOR, MAX_STEP_FACTOR);
+
+            if(errLen > params.tolerance && h > params.minStepLength)
+            {
+                h = (std::max)(h * factor, params.minStepLength);
+                continue;
+            }
+
+            length += distance(p, next);
+            t += dt;
+            p = next;
+            k[0] = k[6];
+            h *= factor;
+
+            positions.push_back(p);
+            times.push_back(sign * t);
+            ++pointCount;
+        }
+    }
+
+    // trace one streamline. upstream points are collected in the given
+    // buffers first, and then appended in reversed order
+    void traceStreamline(
+        const VelocityField           &field,
+        const StreamlineTracingParams &params,
+        const Vec3                    &seed,
+        std::vector<Vec3>             &upstreamPositions,
+        std::vector<float>            &upstreamTimes,
+        std::vector<Vec3>             &positions,
+        std::vector<float>            &times)
+    {
+        const auto seedVelocity = field.getVelocity(seed);
+        if(!seedVelocity)
+        {
+            positions.push_back(seed);
+            times.push_back(0);
+            return;
+        }
+
+        const auto trace = [&](
+            float sign, std::vector<Vec3> &outPositions, std::vector<float> &outTimes)
+        {
+            const DirectionalField directionalField(field, sign);
+            if(params.method == StreamlineTracingParams::Method::RK4)
+            {
+                traceRK4(
+                    directionalField, params, sign, seed,
+                    sign * *seedVelocity, outPositions, outTimes);
+            }
+            else
+            {
+                traceRK45(
+                    directionalField, params, sign, seed,
+                    sign * *seedVelocity, outPositions, outTimes);
+            }
+        };
+
+        if(params.bothDirections)
+        {
+            upstreamPositions.clear();
+            upstreamTimes.clear();
+            trace(-1, upstreamPositions, upstreamTimes);
+
+            positions.insert(
+                positions.end(),
+                upstreamPositions.rbegin(), upstreamPositions.rend());
+            times.insert(
+                times.end(), upstreamTimes.rbegin(), upstreamTimes.rend());
+        }
+
+        positions.push_back(seed);
+        times.push_back(0);
+
+        trace(1, positions, times);
+    }
+
+} // namespace anonymous
+
+PathlineSet traceStreamlines(
+    const VelocityField           &field,
+    const std::vector<Vec3>       &seeds,
+    const StreamlineTracingParams &params,
+    agz::thread::thread_group_t   &threadGroup,
+    StreamlineTracingStats        *stats)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    const int threadCount = agz::thread::actual_worker_count(-1);
+    std::vector<RC<VelocityField>> threadFields;
+    for(int i = 0; i < threadCount; ++i)
+        threadFields.push_back(field.cloneForParallelAccess());
+
+    auto ret = traceStreamlines(threadFields, seeds, params, threadGroup, stats);
+
+    // cloning is part of the tracing time
+    if(stats)
+    {
+        stats->seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    return ret;
+}
+
+PathlineSet traceStreamlines(
+    const std::vector<RC<VelocityField>> &threadFields,
+    const std::vector<Vec3>              &seeds,
+    const StreamlineTracingParams        &params,
+    agz::thread::thread_group_t          &threadGroup,
+    StreamlineTracingStats               *stats)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    const int seedCount   = static_cast<int>(seeds.size());
+    const int threadCount = static_cast<int>(threadFields.size());
+
+    // each block of seeds is traced into its own buffers, which are then
+    // concatenated in seed order
+
+    struct TracedBlock
+    {
+        std::vector<Vec3>    positions;
+        std::vector<float>   times;
+        std::vector<int32_t> counts;
+    };
+
+    const size_t blockCount = (seeds.size() + SEED_BLOCK_SIZE - 1) / SEED_BLOCK_SIZE;
+    std::vector<TracedBlock> blocks(blockCount);
+
+    std::vector<std::vector<Vec3>>  threadUpstreamPositions(threadCount);
+    std::vector<std::vector<float>> threadUpstreamTimes(threadCount);
+
+    parallelForBlocks(
+        threadGroup, threadCount, seeds.size(), SEED_BLOCK_SIZE,
+        [&](int threadIndex, size_t beg, size_t end)
+    {
+        auto &block = blocks[beg / SEED_BLOCK_SIZE];
+        for(size_t i = beg; i < end; ++i)
+        {
+            const size_t first = block.positions.size();
+            traceStreamline(
+                *threadFields[threadIndex], params, seeds[i],
+                threadUpstreamPositions[threadIndex],
+                threadUpstreamTimes[threadIndex],
+                block.positions, block.times);
+            block.counts.push_back(
+                static_cast<int32_t>(block.positions.size() - first));
+        }
+    });
+
+    // offsets are int32, so the sum runs in 64 bits, and streamlines after
+    // the first one crossing INT32_MAX points are left empty. kept points of
+    // each block are then a prefix of it
+
+    PathlineSet ret;
+    ret.offsets.resize(seedCount + 1);
+    ret.offsets[0] = 0;
+
+    std::vector<int32_t> blockOffsets(blockCount + 1);
+    int     seedIndex  = 0;
+    int64_t pointCount = 0;
+    bool    isFull     = false;
+    for(size_t b = 0; b < blockCount; ++b)
+    {
+        blockOffsets[b] = ret.offsets[seedIndex];
+        for(int32_t count : blocks[b].counts)
+        {
+            isFull |=
+                pointCount + count > (std::numeric_limits<int32_t>::max)();
+            if(!isFull)
+                pointCount += count;
+            ret.offsets[++seedIndex] = static_cast<int32_t>(pointCount);
+        }
+    }
+    blockOffsets[blockCount] = ret.offsets.back();
+
+    ret.positions.resize(ret.offsets.back());
+    ret.times.resize(ret.offsets.back());
+
+    parallelForBlocks(
+        threadGroup, threadCount, blockCount, 1,
+        [&](int, size_t b, size_t)
+    {
+        auto &block = blocks[b];
+        const int32_t keptCount = blockOffsets[b + 1] - blockOffsets[b];
+        std::copy(
+            block.positions.begin(), block.positions.begin() + keptCount,
+            ret.positions.begin() + blockOffsets[b]);
+        std::copy(
+            block.times.begin(), block.times.begin() + keptCount,
+            ret.times.begin() + blockOffsets[b]);
+        block = TracedBlock();
+    });
+
+    if(stats)
+    {
+        stats->seedCount  = seedCount;
+        stats->pointCount = ret.getTimepointCount();
+        stats->seconds    = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    return ret;
+}
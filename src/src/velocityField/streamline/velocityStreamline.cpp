@@ -0,0 +1,479 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <QGridLayout>
+#include <QVBoxLayout>
+
+#include <crius/utility/morton.h>
+#include <crius/utility/parallelFor.h>
+#include <crius/velocityField/streamline/velocityStreamline.h>
+
+namespace
+{
+
+    // volume seeding gives up after this many candidates per seed, which
+    // bounds its time on sparse fields
+    constexpr int MAX_CANDIDATES_PER_SEED = 64;
+
+    // volume seeding checks whether it is superseded after at most this
+    // many candidates
+    constexpr size_t MAX_CANDIDATES_PER_ROUND = 1 << 16;
+
+    // seeds are traced and sent to the renderer in batches of this size
+    constexpr size_t TRACE_BATCH_SIZE = 512;
+
+    // the cache is dropped when it holds more points than this
+    constexpr size_t MAX_CACHED_POINT_COUNT = 1 << 22;
+
+    // points of a streamline in each direction
+    constexpr int MAX_POINT_COUNT = 2000;
+
+    // all streamlines shown are gathered into one pathline set with int32
+    // offsets, which must hold seedCount * (2 * MAX_POINT_COUNT + 1) points
+    constexpr int MAX_SEED_COUNT =
+        (std::numeric_limits<int32_t>::max)() / (2 * MAX_POINT_COUNT + 1);
+
+    float radicalInverse(uint32_t a, uint32_t b) noexcept
+    {
+        float f = 1, r = 0;
+        while(a > 0)
+        {
+            f /= b;
+            r += f * (a % b);
+            a /= b;
+        }
+        return r;
+    }
+
+} // namespace anonymous
+
+VelocityStreamline::VelocityStreamline(
+    QWidget                        *parent,
+    RC<const VelocityField>         velocityField,
+    RC<agz::thread::thread_group_t> threadGroup)
+    : QWidget(parent),
+      velocityField_(std::move(velocityField)),
+      threadGroup_(std::move(threadGroup))
+{
+    const AABB bbox = velocityField_->getBoundingBox();
+    normalizeOffset_ = -0.5f * (bbox.lower + bbox.upper);
+    normalizeScale_  =
+        1 / (std::max)((bbox.upper - bbox.lower).max_elem(), 0.001f);
+
+    auto layout     = new QVBoxLayout(this);
+    auto upPanel    = new QFrame(this);
+    auto downPanel  = new QFrame(this);
+    auto upLayout   = new QHBoxLayout(upPanel);
+    auto downLayout = new QGridLayout(downPanel);
+
+    upPanel->setFrameShape(QFrame::Box);
+    downPanel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+
+    layout->addWidget(upPanel);
+    layout->addWidget(downPanel);
+
+    renderer_ = new PathlineRenderer(upPanel, PathlineSet(), *threadGroup_);
+    renderer_->setBoundingBox({
+        normalizeScale_ * (bbox.lower + normalizeOffset_),
+        normalizeScale_ * (bbox.upper + normalizeOffset_) });
+    upLayout->addWidget(renderer_);
+
+    auto seederTypeText   = new QLabel("Seeder", downPanel);
+    auto rakeAxisText     = new QLabel("Rake axis", downPanel);
+    auto rakePositionText = new QLabel("Rake position", downPanel);
+    auto seedCountText    = new QLabel("Number of seeds", downPanel);
+    auto methodText       = new QLabel("Integrator", downPanel);
+
+    seederType_   = new QComboBox(downPanel);
+    rakeAxis_     = new QComboBox(downPanel);
+    rakePosition_ = new DoubleSlider(downPanel);
+    seedCount_    = new QSpinBox(downPanel);
+    method_       = new QComboBox(downPanel);
+    stats_        = new QLabel(downPanel);
+
+    seederType_->addItems({ "Volume", "Line rake", "Plane rake" });
+    seederType_->setCurrentIndex(0);
+    rakeAxis_->addItems({ "X", "Y", "Z" });
+    rakeAxis_->setCurrentIndex(0);
+    rakeAxis_->setEnabled(false);
+    rakePosition_->setRange(0, 1);
+    rakePosition_->setValue(0.5);
+    rakePosition_->setEnabled(false);
+    seedCount_->setRange(1, MAX_SEED_COUNT);
+    seedCount_->setValue(2000);
+    method_->addItems({ "RK45 adaptive", "RK4" });
+    method_->setCurrentIndex(0);
+
+    seederTypeText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    rakeAxisText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    rakePositionText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    seedCountText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    methodText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+
+    downLayout->addWidget(seederTypeText,   0, 0, 1, 1);
+    downLayout->addWidget(seederType_,      0, 1, 1, 1);
+    downLayout->addWidget(rakeAxisText,     0, 2, 1, 1);
+    downLayout->addWidget(rakeAxis_,        0, 3, 1, 1);
+    downLayout->addWidget(rakePositionText, 1, 0, 1, 1);
+    downLayout->addWidget(rakePosition_,    1, 1, 1, 3);
+    downLayout->addWidget(seedCountText,    2, 0, 1, 1);
+    downLayout->addWidget(seedCount_,       2, 1, 1, 1);
+    downLayout->addWidget(methodText,       2, 2, 1, 1);
+    downLayout->addWidget(method_,          2, 3, 1, 1);
+    downLayout->addWidget(stats_,           3, 0, 1, 4);
+
+    connect(seederType_, qOverload<int>(&QComboBox::currentIndexChanged),
+            [this](int index)
+    {
+        rakeAxis_->setEnabled(index != 0);
+        rakePosition_->setEnabled(index != 0);
+        requestTrace(false);
+    });
+
+    connect(rakeAxis_, qOverload<int>(&QComboBox::currentIndexChanged),
+            [this](int)
+    {
+        requestTrace(false);
+    });
+
+    connect(rakePosition_, &DoubleSlider::changingValue,
+            [this]
+    {
+        requestTrace(false);
+    });
+
+    connect(seedCount_, qOverload<int>(&QSpinBox::valueChanged),
+            [this](int)
+    {
+        requestTrace(false);
+    });
+
+    // cached streamlines were traced with the old integrator
+
+    connect(method_, qOverload<int>(&QComboBox::currentIndexChanged),
+            [this](int)
+    {
+        requestTrace(true);
+    });
+
+    // worker
+
+    workerThreadGroup_ = newRC<agz::thread::thread_group_t>();
+    const int workerThreadCount = agz::thread::actual_worker_count(-1);
+    for(int i = 0; i < workerThreadCount; ++i)
+        workerThreadFields_.push_back(velocityField_->cloneForParallelAccess());
+
+    worker_ = std::thread([this] { runWorker(); });
+
+    requestTrace(false);
+}
+
+VelocityStreamline::~VelocityStreamline()
+{
+    {
+        std::lock_guard lock(workerMutex_);
+        stopWorker_ = true;
+        ++generation_;
+    }
+    workerCondition_.notify_one();
+    worker_.join();
+}
+
+VelocityStreamline::SeederSettings
+    VelocityStreamline::getSeederSettings() const
+{
+    SeederSettings ret;
+    ret.type      = static_cast<SeederType>(seederType_->currentIndex());
+    ret.axis      = rakeAxis_->currentIndex();
+    ret.position  = static_cast<float>(rakePosition_->getValue());
+    ret.seedCount = seedCount_->value();
+    return ret;
+}
+
+StreamlineTracingParams VelocityStreamline::getTracingParams() const
+{
+    const AABB bbox = velocityField_->getBoundingBox();
+    const float diag = distance(bbox.lower, bbox.upper);
+
+    StreamlineTracingParams params;
+    params.method = method_->currentIndex() == 0 ?
+        StreamlineTracingParams::Method::RK45 :
+        StreamlineTracingParams::Method::RK4;
+    params.stepLength    = 0.002f * diag;
+    params.minStepLength = 1e-5f * diag;
+    params.maxStepLength = 0.02f * diag;
+    params.tolerance     = 1e-5f * diag;
+    params.minSpeed      =
+        1e-6f * velocityField_->getMaxVelocity(VelocityField::All);
+    params.maxPointCount = MAX_POINT_COUNT;
+    params.maxLength     = 2 * diag;
+    return params;
+}
+
+void VelocityStreamline::requestTrace(bool clearCache)
+{
+    shownTracedCount_ = 0;
+    shownCachedCount_ = 0;
+    shownSeconds_     = 0;
+    renderer_->clearPathlines();
+
+    {
+        std::lock_guard lock(workerMutex_);
+
+        // a cache clearing request must not be lost when superseded before
+        // the worker picks it up
+        if(pendingRequest_ && pendingRequest_->clearCache)
+            clearCache = true;
+
+        pendingRequest_ = TraceRequest{
+            ++generation_, getSeederSettings(), getTracingParams(), clearCache };
+    }
+    workerCondition_.notify_one();
+}
+
+void VelocityStreamline::onBatchTraced(
+    int generation, const PathlineSet &batch,
+    int tracedCount, int cachedCount, double seconds)
+{
+    if(generation != generation_)
+        return;
+
+    renderer_->appendPathlines(batch, *threadGroup_);
+
+    shownTracedCount_ += tracedCount;
+    shownCachedCount_ += cachedCount;
+    shownSeconds_     += seconds;
+
+    const double seedsPerSecond =
+        shownSeconds_ > 0 ? shownTracedCount_ / shownSeconds_ : 0.0;
+    stats_->setText(
+        QString("Traced %1 seeds (%2 seeds/s), %3 seeds from cache")
+            .arg(shownTracedCount_)
+            .arg(seedsPerSecond, 0, 'f', 0)
+            .arg(shownCachedCount_));
+}
+
+void VelocityStreamline::runWorker()
+{
+    for(;;)
+    {
+        TraceRequest request;
+        {
+            std::unique_lock lock(workerMutex_);
+            workerCondition_.wait(lock, [&]
+            {
+                return stopWorker_ || pendingRequest_.has_value();
+            });
+            if(stopWorker_)
+                return;
+
+            request = std::move(*pendingRequest_);
+            pendingRequest_.reset();
+        }
+
+        processRequest(request);
+    }
+}
+
+void VelocityStreamline::processRequest(const TraceRequest &request)
+{
+    if(request.clearCache)
+    {
+        cache_.clear();
+        cachedPointCount_ = 0;
+    }
+
+    const std::vector<Vec3> seeds = generateSeeds(
+        request.generation, request.seeder);
+    if(request.generation != generation_)
+        return;
+    const AABB bbox = velocityField_->getBoundingBox();
+
+    std::vector<uint64_t> keys;
+    std::vector<uint8_t>  isMissing;
+    std::vector<Vec3>     missingSeeds;
+
+    for(size_t batchBeg = 0; batchBeg < seeds.size();
+        batchBeg += TRACE_BATCH_SIZE)
+    {
+        // stop at batch granularity once superseded
+        if(request.generation != generation_)
+            return;
+
+        const size_t batchEnd =
+            (std::min)(batchBeg + TRACE_BATCH_SIZE, seeds.size());
+
+        // trace seeds missing in the cache
+
+        keys.clear();
+        isMissing.clear();
+        missingSeeds.clear();
+        for(size_t i = batchBeg; i < batchEnd; ++i)
+        {
+            keys.push_back(mortonCode(seeds[i], bbox));
+            isMissing.push_back(!cache_.count(keys.back()));
+            if(isMissing.back())
+                missingSeeds.push_back(seeds[i]);
+        }
+
+        StreamlineTracingStats stats;
+        const PathlineSet traced = traceStreamlines(
+            workerThreadFields_, missingSeeds, request.params,
+            *workerThreadGroup_, &stats);
+
+        // gather the batch in seed order, caching traced streamlines, and
+        // normalize positions for the renderer
+
+        auto batch = newRC<PathlineSet>();
+        int tracedIndex = 0;
+        for(size_t i = 0; i < keys.size(); ++i)
+        {
+            auto it = cache_.end();
+            if(isMissing[i])
+            {
+                const int beg = traced.offsets[tracedIndex];
+                const int end = traced.offsets[tracedIndex + 1];
+                ++tracedIndex;
+
+                CachedStreamline line;
+                line.positions.assign(
+                    traced.positions.begin() + beg,
+                    traced.positions.begin() + end);
+                line.times.assign(
+                    traced.times.begin() + beg, traced.times.begin() + end);
+                cachedPointCount_ += line.positions.size();
+                it = cache_.insert_or_assign(keys[i], std::move(line)).first;
+            }
+            else
+                it = cache_.find(keys[i]);
+
+            const CachedStreamline &line = it->second;
+            for(auto &p : line.positions)
+                batch->positions.push_back(normalizeScale_ * (p + normalizeOffset_));
+            batch->times.insert(
+                batch->times.end(), line.times.begin(), line.times.end());
+            batch->offsets.push_back(
+                static_cast<int32_t>(batch->positions.size()));
+        }
+
+        if(cachedPointCount_ > MAX_CACHED_POINT_COUNT)
+        {
+            cache_.clear();
+            cachedPointCount_ = 0;
+        }
+
+        const int tracedCount = static_cast<int>(missingSeeds.size());
+        const int cachedCount = static_cast<int>(keys.size()) - tracedCount;
+        const double seconds  = stats.seconds;
+        const int generation  = request.generation;
+
+        QMetaObject::invokeMethod(this, [=]
+        {
+            onBatchTraced(generation, *batch, tracedCount, cachedCount, seconds);
+        }, Qt::QueuedConnection);
+    }
+}
+
+std::vector<Vec3> VelocityStreamline::generateSeeds(
+    int generation, const SeederSettings &seeder)
+{
+    const AABB bbox = velocityField_->getBoundingBox();
+    const Vec3 extent = bbox.upper - bbox.lower;
+    const int threadCount = static_cast<int>(workerThreadFields_.size());
+
+    std::vector<Vec3> ret;
+
+    // rakes
+
+    if(seeder.type != SeederType::Volume)
+    {
+        const int a = seeder.axis;
+        const int u = (a + 1) % 3;
+        const int w = (a + 2) % 3;
+
+        Vec3 seed;
+        seed[a] = bbox.lower[a] + seeder.position * extent[a];
+        seed[w] = bbox.lower[w] + 0.5f * extent[w];
+
+        if(seeder.type == SeederType::Line)
+        {
+            for(int i = 0; i < seeder.seedCount; ++i)
+            {
+                seed[u] = bbox.lower[u] + (i + 0.5f) / seeder.seedCount * extent[u];
+                ret.push_back(seed);
+            }
+        }
+        else
+        {
+            const int side = static_cast<int>(std::ceil(std::sqrt(
+                static_cast<float>(seeder.seedCount))));
+            for(int j = 0; j < side; ++j)
+            {
+                for(int i = 0; i < side; ++i)
+                {
+                    seed[u] = bbox.lower[u] + (i + 0.5f) / side * extent[u];
+                    seed[w] = bbox.lower[w] + (j + 0.5f) / side * extent[w];
+                    ret.push_back(seed);
+                }
+            }
+        }
+
+        return ret;
+    }
+
+    // halton points, checked in rounds of about twice the missing seeds.
+    // seeding stops between rounds once the request is superseded
+
+    const auto getCandidate = [&](size_t index)
+    {
+        const uint32_t i = static_cast<uint32_t>(index + 1);
+        return bbox.lower + extent * Vec3(
+            radicalInverse(i, 2), radicalInverse(i, 3), radicalInverse(i, 5));
+    };
+
+    std::vector<uint8_t> valid;
+
+    const size_t seedCount = static_cast<size_t>(seeder.seedCount);
+    const size_t maxCandidates = seedCount * MAX_CANDIDATES_PER_SEED;
+    size_t nextCandidate = 0;
+
+    while(ret.size() < seedCount && nextCandidate < maxCandidates)
+    {
+        if(generation != generation_)
+            return {};
+
+        const size_t roundSize = (std::min)({
+            maxCandidates - nextCandidate,
+            (std::max<size_t>)(2 * (seedCount - ret.size()), 1024),
+            MAX_CANDIDATES_PER_ROUND });
+        valid.assign(roundSize, 0);
+
+        parallelForBlocks(
+            *workerThreadGroup_, threadCount, roundSize, 256,
+            [&](int threadIndex, size_t beg, size_t end)
+        {
+            // candidates in outside voxels are rejected without a cell
+            // lookup. inside voxels may still have small holes
+            const VelocityField &field = *workerThreadFields_[threadIndex];
+            for(size_t i = beg; i < end; ++i)
+            {
+                const Vec3 candidate = getCandidate(nextCandidate + i);
+                valid[i] =
+                    field.getOccupancy(candidate) !=
+                        VelocityField::Occupancy::Outside &&
+                    field.getVelocity(candidate).has_value();
+            }
+        });
+
+        for(size_t i = 0; i < roundSize && ret.size() < seedCount; ++i)
+        {
+            if(valid[i])
+                ret.push_back(getCandidate(nextCandidate + i));
+        }
+
+        nextCandidate += roundSize;
+    }
+
+    return ret;
+}
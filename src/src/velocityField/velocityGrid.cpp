@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cmath>
+
+#include <crius/utility/parallelFor.h>
+#include <crius/velocityField/velocityGrid.h>
+
+VelocityGrid::VelocityGrid(
+    const VelocityField         &field,
+    int                          maxResolution,
+    agz::thread::thread_group_t &threadGroup)
+{
+    bound_ = field.getBoundingBox();
+
+    const Vec3 extent = bound_.upper - bound_.lower;
+    const float maxExtent = (std::max)(
+        (std::max)(extent.x, extent.y), (std::max)(extent.z, 1e-20f));
+    const auto axisResolution = [&](float axisExtent)
+    {
+        return (std::max)(1, static_cast<int>(
+            std::ceil(maxResolution * axisExtent / maxExtent)));
+    };
+
+    res_ = Vec3i(
+        axisResolution(extent.x),
+        axisResolution(extent.y),
+        axisResolution(extent.z));
+    cellSize_ = extent / Vec3(
+        static_cast<float>(res_.x),
+        static_cast<float>(res_.y),
+        static_cast<float>(res_.z));
+
+    velocities_.resize(getCellCount());
+    valid_.resize(getCellCount());
+
+    // each worker samples whole z slices with its own copy of the field
+
+    const int threadCount = agz::thread::actual_worker_count(-1);
+    std::vector<RC<VelocityField>> threadFields;
+    for(int i = 0; i < threadCount; ++i)
+        threadFields.push_back(field.cloneForParallelAccess());
+
+    std::vector<float> threadMaxSpeed(threadCount, 0.0f);
+
+    parallelForBlocks(
+        threadGroup, threadCount, res_.z, 1,
+        [&](int threadIndex, size_t z, size_t)
+    {
+        const VelocityField &threadField = *threadFields[threadIndex];
+        for(int y = 0; y < res_.y; ++y)
+        {
+            for(int x = 0; x < res_.x; ++x)
+            {
+                const int z32 = static_cast<int>(z);
+                const int i = getCellIndex(x, y, z32);
+                const auto vel = threadField.getVelocity(
+                    getCellCenter(x, y, z32));
+
+                valid_[i]      = vel.has_value();
+                velocities_[i] = vel ? *vel : Vec3(0);
+
+                if(vel)
+                {
+                    threadMaxSpeed[threadIndex] = (std::max)(
+                        threadMaxSpeed[threadIndex], vel->length());
+                }
+            }
+        }
+    });
+
+    for(float s : threadMaxSpeed)
+        maxSpeed_ = (std::max)(maxSpeed_, s);
+}
+
+const AABB &VelocityGrid::getBoundingBox() const noexcept
+{
+    return bound_;
+}
+
+const Vec3i &VelocityGrid::getResolution() const noexcept
+{
+    return res_;
+}
+
+const Vec3 &VelocityGrid::getCellSize() const noexcept
+{
+    return cellSize_;
+}
+
+int VelocityGrid::getCellCount() const noexcept
+{
+    return res_.x * res_.y * res_.z;
+}
+
+int VelocityGrid::getCellIndex(int x, int y, int z) const noexcept
+{
+    return (z * res_.y + y) * res_.x + x;
+}
+
+Vec3 VelocityGrid::getCellCenter(int x, int y, int z) const noexcept
+{
+    return bound_.lower + cellSize_ * Vec3(x + 0.5f, y + 0.5f, z + 0.5f);
+}
+
+bool VelocityGrid::isValid(int cellIndex) const noexcept
+{
+    return valid_[cellIndex] != 0;
+}
+
+const Vec3 &VelocityGrid::getVelocity(int cellIndex) const noexcept
+{
+    return velocities_[cellIndex];
+}
+
+float VelocityGrid::getMaxSpeed() const noexcept
+{
+    return maxSpeed_;
+}
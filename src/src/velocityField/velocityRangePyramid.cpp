@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <crius/velocityField/velocityRangePyramid.h>
+
+namespace
+{
+
+    bool isInside(const AABB &inner, const AABB &outer) noexcept
+    {
+        for(int i = 0; i < 3; ++i)
+        {
+            if(inner.lower[i] < outer.lower[i] || outer.upper[i] < inner.upper[i])
+                return false;
+        }
+        return true;
+    }
+
+    bool isOverlapping(const AABB &a, const AABB &b) noexcept
+    {
+        for(int i = 0; i < 3; ++i)
+        {
+            if(a.upper[i] < b.lower[i] || b.upper[i] < a.lower[i])
+                return false;
+        }
+        return true;
+    }
+
+} // namespace anonymous
+
+VelocityRangePyramid::VelocityRangePyramid(
+    const AABB &bound, int maxResolution)
+    : bound_(bound)
+{
+    const Vec3 extent = bound_.upper - bound_.lower;
+    const float maxExtent = (std::max)(
+        (std::max)(extent.x, extent.y), (std::max)(extent.z, 1e-20f));
+    const auto axisResolution = [&](float axisExtent)
+    {
+        return (std::max)(1, static_cast<int>(
+            std::ceil(maxResolution * axisExtent / maxExtent)));
+    };
+
+    Level finest;
+    finest.res = Vec3i(
+        axisResolution(extent.x),
+        axisResolution(extent.y),
+        axisResolution(extent.z));
+
+    // a flat axis, e.g. z of a 2d case, gets a tiny positive brick size so
+    // that coordinates can be divided by it
+    finest.brickSize = Vec3(
+        (std::max)(extent.x, 1e-20f),
+        (std::max)(extent.y, 1e-20f),
+        (std::max)(extent.z, 1e-20f)) / Vec3(
+        static_cast<float>(finest.res.x),
+        static_cast<float>(finest.res.y),
+        static_cast<float>(finest.res.z));
+
+    Brick emptyBrick;
+    for(int i = 0; i < 4; ++i)
+    {
+        emptyBrick.low[i]  = (std::numeric_limits<float>::max)();
+        emptyBrick.high[i] = std::numeric_limits<float>::lowest();
+    }
+    finest.bricks.resize(
+        static_cast<size_t>(finest.res.x) * finest.res.y * finest.res.z,
+        emptyBrick);
+
+    levels_.push_back(std::move(finest));
+}
+
+void VelocityRangePyramid::addCell(
+    const AABB &cellBound, const Vec3 &velocity) noexcept
+{
+    Level &finest = levels_.front();
+
+    // coordinates are clamped before the cast, which would be undefined
+    // for values out of the int range
+
+    int lower[3], upper[3];
+    for(int i = 0; i < 3; ++i)
+    {
+        const float rcpSize = 1 / finest.brickSize[i];
+        const float maxIndex = static_cast<float>(finest.res[i] - 1);
+        lower[i] = static_cast<int>(agz::math::clamp(std::floor(
+            (cellBound.lower[i] - bound_.lower[i]) * rcpSize), 0.0f, maxIndex));
+        upper[i] = static_cast<int>(agz::math::clamp(std::floor(
+            (cellBound.upper[i] - bound_.lower[i]) * rcpSize), 0.0f, maxIndex));
+    }
+
+    const float values[4] = {
+        velocity.x, velocity.y, velocity.z, velocity.length()
+    };
+
+    for(int z = lower[2]; z <= upper[2]; ++z)
+    {
+        for(int y = lower[1]; y <= upper[1]; ++y)
+        {
+            for(int x = lower[0]; x <= upper[0]; ++x)
+            {
+                Brick &brick = finest.bricks[finest.getBrickIndex(x, y, z)];
+                for(int i = 0; i < 4; ++i)
+                {
+                    brick.low[i]  = (std::min)(brick.low[i], values[i]);
+                    brick.high[i] = (std::max)(brick.high[i], values[i]);
+                }
+            }
+        }
+    }
+}
+
+void VelocityRangePyramid::build()
+{
+    levels_.resize(1);
+
+    for(;;)
+    {
+        const Level &fine = levels_.back();
+        if(fine.res.x == 1 && fine.res.y == 1 && fine.res.z == 1)
+            break;
+
+        Level coarse;
+        coarse.res = Vec3i(
+            (fine.res.x + 1) / 2, (fine.res.y + 1) / 2, (fine.res.z + 1) / 2);
+        coarse.brickSize = 2.0f * fine.brickSize;
+        coarse.bricks.resize(
+            static_cast<size_t>(coarse.res.x) * coarse.res.y * coarse.res.z);
+
+        for(int z = 0; z < coarse.res.z; ++z)
+        {
+            for(int y = 0; y < coarse.res.y; ++y)
+            {
+                for(int x = 0; x < coarse.res.x; ++x)
+                {
+                    Brick brick = fine.bricks[fine.getBrickIndex(
+                        2 * x, 2 * y, 2 * z)];
+
+                    for(int c = 1; c < 8; ++c)
+                    {
+                        const int fx = 2 * x + (c & 1);
+                        const int fy = 2 * y + ((c >> 1) & 1);
+                        const int fz = 2 * z + ((c >> 2) & 1);
+                        if(fx >= fine.res.x || fy >= fine.res.y || fz >= fine.res.z)
+                            continue;
+
+                        const Brick &child = fine.bricks[
+                            fine.getBrickIndex(fx, fy, fz)];
+                        for(int i = 0; i < 4; ++i)
+                        {
+                            brick.low[i]  = (std::min)(brick.low[i], child.low[i]);
+                            brick.high[i] = (std::max)(brick.high[i], child.high[i]);
+                        }
+                    }
+
+                    coarse.bricks[coarse.getBrickIndex(x, y, z)] = brick;
+                }
+            }
+        }
+
+        levels_.push_back(std::move(coarse));
+    }
+}
+
+std::optional<VelocityField::Range> VelocityRangePyramid::query(
+    const AABB                        &region,
+    VelocityField::VelocityComponent   component) const noexcept
+{
+    if(!isOverlapping(region, bound_))
+        return std::nullopt;
+
+    VelocityField::Range range = {
+        (std::numeric_limits<float>::max)(), std::numeric_limits<float>::lowest()
+    };
+    bool isRangeEmpty = true;
+
+    // the coarsest level has a single brick
+    queryBrick(
+        static_cast<int>(levels_.size()) - 1, 0, 0, 0, region,
+        static_cast<int>(component), range, isRangeEmpty);
+
+    if(isRangeEmpty)
+        return std::nullopt;
+    return range;
+}
+
+void VelocityRangePyramid::queryBrick(
+    int level, int x, int y, int z, const AABB &region, int component,
+    VelocityField::Range &range, bool &isRangeEmpty) const noexcept
+{
+    const Level &lvl = levels_[level];
+    const Brick &brick = lvl.bricks[lvl.getBrickIndex(x, y, z)];
+    if(brick.isEmpty())
+        return;
+
+    const Vec3 brickLower = bound_.lower + lvl.brickSize * Vec3(
+        static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+    const AABB brickBound = { brickLower, brickLower + lvl.brickSize };
+
+    if(!isOverlapping(brickBound, region))
+        return;
+
+    if(level == 0 || isInside(brickBound, region))
+    {
+        range.low  = (std::min)(range.low, brick.low[component]);
+        range.high = (std::max)(range.high, brick.high[component]);
+        isRangeEmpty = false;
+        return;
+    }
+
+    // skip the subtree when it cannot widen the range
+    if(!isRangeEmpty &&
+       range.low <= brick.low[component] && brick.high[component] <= range.high)
+        return;
+
+    const Level &fine = levels_[level - 1];
+    for(int c = 0; c < 8; ++c)
+    {
+        const int fx = 2 * x + (c & 1);
+        const int fy = 2 * y + ((c >> 1) & 1);
+        const int fz = 2 * z + ((c >> 2) & 1);
+        if(fx < fine.res.x && fy < fine.res.y && fz < fine.res.z)
+        {
+            queryBrick(
+                level - 1, fx, fy, fz, region, component, range, isRangeEmpty);
+        }
+    }
+}
@@ -0,0 +1,136 @@
+#include <cmath>
+
+#include <QGridLayout>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+#include <crius/velocityField/volume/velocityVolume.h>
+
+namespace
+{
+
+    // grid resolutions along the longest axis of the field
+    constexpr int RESOLUTIONS[] = { 64, 128, 256 };
+
+} // namespace anonymous
+
+VelocityVolume::VelocityVolume(
+    QWidget                        *parent,
+    RC<const VelocityField>         velocityField,
+    RC<agz::thread::thread_group_t> threadGroup)
+    : QWidget(parent),
+      velocityField_(std::move(velocityField)),
+      threadGroup_(std::move(threadGroup))
+{
+    auto layout     = new QVBoxLayout(this);
+    auto upPanel    = new QFrame(this);
+    auto downPanel  = new QFrame(this);
+    auto upLayout   = new QHBoxLayout(upPanel);
+    auto downLayout = new QGridLayout(downPanel);
+
+    upPanel->setFrameShape(QFrame::Box);
+    downPanel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+
+    layout->addWidget(upPanel);
+    layout->addWidget(downPanel);
+
+    auto resolutionText = new QLabel("Resolution", downPanel);
+    auto quantityText   = new QLabel("Quantity", downPanel);
+    auto opacityText    = new QLabel("Opacity (log10)", downPanel);
+
+    resolution_ = new QComboBox(downPanel);
+    quantity_   = new QComboBox(downPanel);
+    opacity_    = new DoubleSlider(downPanel);
+
+    resolution_->addItems({ "64", "128", "256" });
+    resolution_->setCurrentIndex(1);
+    quantity_->addItems({ "Velocity Magnitude", "Velocity X", "Velocity Y", "Velocity Z" });
+    quantity_->setCurrentIndex(0);
+    opacity_->setRange(-1, 3);
+    opacity_->setValue(1);
+
+    resolutionText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    quantityText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    opacityText->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+
+    // color mapper & color bar
+
+    colorMapper_ = new HSVColorMapper(downPanel);
+    colorMapper_->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
+
+    colorBar_ = new ColorBar(upPanel, colorMapper_);
+    colorBar_->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Ignored);
+
+    // renderer
+
+    renderer_ = new VolumeRenderer(
+        upPanel, createGrid(), colorMapper_, threadGroup_);
+    renderer_->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+    renderer_->setOpacity(std::pow(10.0f, static_cast<float>(opacity_->getValue())));
+
+    auto useDefaultCamera = new QPushButton("Use default camera", downPanel);
+
+    upLayout->addWidget(colorBar_);
+    upLayout->addWidget(renderer_);
+
+    downLayout->addWidget(resolutionText,   0, 0, 1, 1);
+    downLayout->addWidget(resolution_,      0, 1, 1, 1);
+    downLayout->addWidget(quantityText,     1, 0, 1, 1);
+    downLayout->addWidget(quantity_,        1, 1, 1, 1);
+    downLayout->addWidget(opacityText,      2, 0, 1, 1);
+    downLayout->addWidget(opacity_,         2, 1, 1, 1);
+    downLayout->addWidget(useDefaultCamera, 3, 0, 1, 2);
+    downLayout->addWidget(colorMapper_,     0, 2, 4, 1);
+
+    updateColorMapperVelRange();
+
+    connect(resolution_, qOverload<int>(&QComboBox::currentIndexChanged),
+            [this](int)
+    {
+        renderer_->setGrid(createGrid());
+        updateColorMapperVelRange();
+    });
+
+    connect(quantity_, qOverload<int>(&QComboBox::currentIndexChanged),
+            [this](int index)
+    {
+        renderer_->setQuantity(static_cast<VolumeRenderer::Quantity>(index));
+        updateColorMapperVelRange();
+    });
+
+    connect(opacity_, &DoubleSlider::changingValue,
+            [this]
+    {
+        renderer_->setOpacity(
+            std::pow(10.0f, static_cast<float>(opacity_->getValue())));
+    });
+
+    connect(useDefaultCamera, &QPushButton::clicked,
+            [this](bool)
+    {
+        renderer_->useDefaultCamera();
+    });
+
+    connect(colorMapper_, &VelocityColorMapper::editParams,
+            [this]
+    {
+        colorBar_->redraw();
+        renderer_->updateColorMap();
+    });
+}
+
+RC<const VelocityGrid> VelocityVolume::createGrid() const
+{
+    return newRC<VelocityGrid>(
+        *velocityField_, RESOLUTIONS[resolution_->currentIndex()],
+        *threadGroup_);
+}
+
+void VelocityVolume::updateColorMapperVelRange()
+{
+    const float minValue = renderer_->getMinValue();
+    const float maxValue = renderer_->getMaxValue();
+    colorMapper_->setVelocityRange(minValue, maxValue);
+    colorBar_->setParams(minValue, maxValue);
+    renderer_->updateColorMap();
+}
@@ -0,0 +1,500 @@
+#include <algorithm>
+#include <cmath>
+
+#include <QMatrix4x4>
+#include <QMouseEvent>
+#include <QSurfaceFormat>
+
+#include <crius/utility/parallelFor.h>
+#include <crius/velocityField/volume/volumeRenderer.h>
+
+namespace
+{
+
+    // fullscreen triangle
+    const char VOLUME_VS[] = R"___(
+    #version 330 core
+
+    out vec2 ndc;
+
+    void main()
+    {
+        ndc = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2 - 1;
+        gl_Position = vec4(ndc, 0, 1);
+    }
+    )___";
+
+    const char VOLUME_FS[] = R"___(
+    #version 330 core
+
+    uniform mat4 invProjView;
+    uniform vec3 eye;
+    uniform vec3 boxLower;
+    uniform vec3 boxUpper;
+    uniform sampler3D volume;
+    uniform sampler1D colorMap;
+    uniform float stepSize;
+    uniform float extinction;
+    uniform bool signedQuantity;
+    uniform vec3 background;
+
+    in vec2 ndc;
+
+    out vec4 fragColor;
+
+    void main()
+    {
+        vec4 farPoint = invProjView * vec4(ndc, 1, 1);
+        vec3 dir = normalize(farPoint.xyz / farPoint.w - eye);
+
+        vec3 t0 = (boxLower - eye) / dir;
+        vec3 t1 = (boxUpper - eye) / dir;
+        vec3 tMin = min(t0, t1), tMax = max(t0, t1);
+        float tNear = max(max(tMin.x, tMin.y), max(tMin.z, 0));
+        float tFar = min(min(tMax.x, tMax.y), tMax.z);
+
+        // samples are jittered per pixel to hide slicing artifacts
+
+        float jitter = fract(
+            sin(dot(gl_FragCoord.xy, vec2(12.9898, 78.233))) * 43758.5453);
+        vec3 extent = boxUpper - boxLower;
+
+        // front to back compositing, with opacity growing with the distance
+        // of the value from zero
+
+        vec4 acc = vec4(0);
+        for(float t = tNear + jitter * stepSize;
+            t < tFar && acc.a < 0.99; t += stepSize)
+        {
+            vec3 uvw = (eye + t * dir - boxLower) / extent;
+            vec2 s = texture(volume, uvw).rg;
+            if(s.g <= 0)
+                continue;
+
+            float strength = signedQuantity ? abs(2 * s.r - 1) : s.r;
+            float alpha = 1 - exp(-extinction * s.g * strength * stepSize);
+            vec3 color = texture(colorMap, s.r).rgb;
+
+            acc.rgb += (1 - acc.a) * alpha * color;
+            acc.a += (1 - acc.a) * alpha;
+        }
+
+        fragColor = vec4(acc.rgb + (1 - acc.a) * background, 1);
+    }
+    )___";
+
+    constexpr float PERSPECTIVE_FOV_DEG = 40.0f;
+
+    // texels are converted and uploaded in slabs of z slices holding about
+    // this many texels, which bounds the staging memory
+    constexpr size_t UPLOAD_SLAB_TEXEL_COUNT = 1 << 22;
+
+    // the color map texture samples the color mapper at this many values
+    constexpr int COLOR_MAP_SIZE = 256;
+
+    // rays are marched with steps of this many cells
+    constexpr float STEP_SIZE_IN_CELLS = 0.5f;
+
+} // namespace anonymous
+
+VolumeRenderer::VolumeRenderer(
+    QWidget                        *parent,
+    RC<const VelocityGrid>          grid,
+    VelocityColorMapper            *colorMapper,
+    RC<agz::thread::thread_group_t> threadGroup)
+    : QOpenGLWidget(parent),
+      colorMapper_(colorMapper),
+      threadGroup_(std::move(threadGroup))
+{
+    QSurfaceFormat format;
+    format.setMajorVersion(3);
+    format.setMinorVersion(3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+#ifdef AGZ_DEBUG
+    format.setOption(QSurfaceFormat::DebugContext);
+#endif
+    setFormat(format);
+
+    setGrid(std::move(grid));
+}
+
+VolumeRenderer::~VolumeRenderer()
+{
+    makeCurrent();
+
+    if(vao_)
+        glDeleteVertexArrays(1, &vao_);
+    if(volumeTexture_)
+        glDeleteTextures(1, &volumeTexture_);
+    if(colorMapTexture_)
+        glDeleteTextures(1, &colorMapTexture_);
+
+    doneCurrent();
+}
+
+void VolumeRenderer::setGrid(RC<const VelocityGrid> grid)
+{
+    grid_ = std::move(grid);
+    updateValueRange();
+    isVolumeDirty_ = true;
+    useDefaultCamera();
+}
+
+void VolumeRenderer::setQuantity(Quantity quantity)
+{
+    quantity_ = quantity;
+    updateValueRange();
+    isVolumeDirty_ = true;
+    update();
+}
+
+void VolumeRenderer::setOpacity(float opacity)
+{
+    opacity_ = opacity;
+    update();
+}
+
+void VolumeRenderer::updateColorMap()
+{
+    isColorMapDirty_ = true;
+    update();
+}
+
+float VolumeRenderer::getMinValue() const noexcept
+{
+    return minValue_;
+}
+
+float VolumeRenderer::getMaxValue() const noexcept
+{
+    return maxValue_;
+}
+
+void VolumeRenderer::useDefaultCamera()
+{
+    const AABB &bbox = grid_->getBoundingBox();
+    horiRad_  = 0;
+    vertRad_  = 0;
+    distance_ = 1.1f * distance(bbox.lower, bbox.upper);
+    lookAt_   = 0.5f * (bbox.lower + bbox.upper);
+    update();
+}
+
+void VolumeRenderer::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    volumeShader_.addShaderFromSourceCode(QOpenGLShader::Vertex, VOLUME_VS);
+    volumeShader_.addShaderFromSourceCode(QOpenGLShader::Fragment, VOLUME_FS);
+    volumeShader_.link();
+
+    // the fullscreen triangle needs no vertex attribute, but core profile
+    // requires a vao to be bound
+    glGenVertexArrays(1, &vao_);
+
+    glGenTextures(1, &volumeTexture_);
+    glBindTexture(GL_TEXTURE_3D, volumeTexture_);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    glGenTextures(1, &colorMapTexture_);
+    glBindTexture(GL_TEXTURE_1D, colorMapTexture_);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_1D, 0);
+
+    glDisable(GL_DEPTH_TEST);
+}
+
+void VolumeRenderer::paintGL()
+{
+    if(isVolumeDirty_)
+    {
+        uploadVolume();
+        isVolumeDirty_ = false;
+    }
+
+    if(isColorMapDirty_)
+    {
+        std::vector<Vec3> colors(COLOR_MAP_SIZE);
+        for(int i = 0; i < COLOR_MAP_SIZE; ++i)
+        {
+            const float t = static_cast<float>(i) / (COLOR_MAP_SIZE - 1);
+            const QColor qcolor = colorMapper_->getColor(
+                agz::math::lerp(minValue_, maxValue_, t));
+            colors[i] = Vec3(qcolor.redF(), qcolor.greenF(), qcolor.blueF());
+        }
+
+        glBindTexture(GL_TEXTURE_1D, colorMapTexture_);
+        glTexImage1D(
+            GL_TEXTURE_1D, 0, GL_RGB32F, COLOR_MAP_SIZE, 0,
+            GL_RGB, GL_FLOAT, colors.data());
+        glBindTexture(GL_TEXTURE_1D, 0);
+
+        isColorMapDirty_ = false;
+    }
+
+    const Vec3 dir = {
+        std::cos(vertRad_) * std::cos(horiRad_),
+        std::sin(vertRad_),
+        std::cos(vertRad_) * std::sin(horiRad_)
+    };
+    const Vec3 eye = lookAt_ - dir * distance_;
+
+    QMatrix4x4 view, proj;
+    view.lookAt(
+        QVector3D(eye.x, eye.y, eye.z),
+        QVector3D(lookAt_.x, lookAt_.y, lookAt_.z),
+        QVector3D(0, 1, 0));
+    proj.perspective(
+        PERSPECTIVE_FOV_DEG, static_cast<float>(width()) / height(),
+        0.01f * distance_, 100 * distance_);
+
+    const AABB &bbox = grid_->getBoundingBox();
+    const Vec3 &cellSize = grid_->getCellSize();
+    const float stepSize = STEP_SIZE_IN_CELLS * (std::min)(
+        cellSize.x, (std::min)(cellSize.y, cellSize.z));
+
+    volumeShader_.bind();
+    volumeShader_.setUniformValue(
+        volumeShader_.uniformLocation("invProjView"),
+        (proj * view).inverted());
+    volumeShader_.setUniformValue(
+        volumeShader_.uniformLocation("eye"), QVector3D(eye.x, eye.y, eye.z));
+    volumeShader_.setUniformValue(
+        volumeShader_.uniformLocation("boxLower"),
+        QVector3D(bbox.lower.x, bbox.lower.y, bbox.lower.z));
+    volumeShader_.setUniformValue(
+        volumeShader_.uniformLocation("boxUpper"),
+        QVector3D(bbox.upper.x, bbox.upper.y, bbox.upper.z));
+    volumeShader_.setUniformValue(
+        volumeShader_.uniformLocation("volume"), 0);
+    volumeShader_.setUniformValue(
+        volumeShader_.uniformLocation("colorMap"), 1);
+    volumeShader_.setUniformValue(
+        volumeShader_.uniformLocation("stepSize"), stepSize);
+    volumeShader_.setUniformValue(
+        volumeShader_.uniformLocation("extinction"),
+        opacity_ / distance(bbox.lower, bbox.upper));
+    volumeShader_.setUniformValue(
+        volumeShader_.uniformLocation("signedQuantity"),
+        quantity_ != Quantity::Magnitude);
+    volumeShader_.setUniformValue(
+        volumeShader_.uniformLocation("background"), QVector3D(0, 0.3f, 0.3f));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, volumeTexture_);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, colorMapTexture_);
+
+    glBindVertexArray(vao_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    volumeShader_.release();
+}
+
+void VolumeRenderer::updateValueRange()
+{
+    const int cellCount   = grid_->getCellCount();
+    const int threadCount = agz::thread::actual_worker_count(-1);
+
+    // magnitudes are mapped from [0, max], and components from a range
+    // symmetric around zero so that zero stays transparent
+
+    if(quantity_ == Quantity::Magnitude)
+    {
+        minValue_ = 0;
+        maxValue_ = (std::max)(grid_->getMaxSpeed(), 1e-20f);
+        isColorMapDirty_ = true;
+        return;
+    }
+
+    const int axis = static_cast<int>(quantity_) - 1;
+    std::vector<float> threadMaxAbs(threadCount, 0.0f);
+    parallelForBlocks(
+        *threadGroup_, threadCount, cellCount, 1 << 16,
+        [&](int threadIndex, size_t beg, size_t end)
+    {
+        float maxAbs = threadMaxAbs[threadIndex];
+        for(size_t i = beg; i < end; ++i)
+        {
+            if(grid_->isValid(static_cast<int>(i)))
+            {
+                maxAbs = (std::max)(
+                    maxAbs, std::abs(grid_->getVelocity(static_cast<int>(i))[axis]));
+            }
+        }
+        threadMaxAbs[threadIndex] = maxAbs;
+    });
+
+    const float maxAbs = (std::max)(
+        *std::max_element(threadMaxAbs.begin(), threadMaxAbs.end()), 1e-20f);
+    minValue_ = -maxAbs;
+    maxValue_ = maxAbs;
+    isColorMapDirty_ = true;
+}
+
+void VolumeRenderer::uploadVolume()
+{
+    const Vec3i &res = grid_->getResolution();
+    const size_t sliceTexelCount = static_cast<size_t>(res.x) * res.y;
+    const int slabDepth = static_cast<int>((std::max<size_t>)(
+        1, UPLOAD_SLAB_TEXEL_COUNT / sliceTexelCount));
+    const int threadCount = agz::thread::actual_worker_count(-1);
+
+    const int axis = static_cast<int>(quantity_) - 1;
+    const float rcpRange = 1 / (maxValue_ - minValue_);
+
+    // invalid texels hold the normalized zero, so that linear filtering next
+    // to them fades values toward zero instead of toward the range bound
+    const uint16_t invalidValue = static_cast<uint16_t>(
+        agz::math::saturate(-minValue_ * rcpRange) * 65535 + 0.5f);
+
+    glBindTexture(GL_TEXTURE_3D, volumeTexture_);
+    glTexImage3D(
+        GL_TEXTURE_3D, 0, GL_RG16, res.x, res.y, res.z, 0,
+        GL_RG, GL_UNSIGNED_SHORT, nullptr);
+
+    std::vector<uint16_t> slab(2 * sliceTexelCount * slabDepth);
+    for(int zBeg = 0; zBeg < res.z; zBeg += slabDepth)
+    {
+        const int zEnd = (std::min)(zBeg + slabDepth, res.z);
+        const size_t firstCell = zBeg * sliceTexelCount;
+        const size_t slabTexelCount = (zEnd - zBeg) * sliceTexelCount;
+
+        parallelForBlocks(
+            *threadGroup_, threadCount, slabTexelCount, 1 << 14,
+            [&](int, size_t beg, size_t end)
+        {
+            for(size_t i = beg; i < end; ++i)
+            {
+                const int cell = static_cast<int>(firstCell + i);
+                if(!grid_->isValid(cell))
+                {
+                    slab[2 * i]     = invalidValue;
+                    slab[2 * i + 1] = 0;
+                    continue;
+                }
+
+                const Vec3 &vel = grid_->getVelocity(cell);
+                const float value = axis < 0 ? vel.length() : vel[axis];
+                const float t = agz::math::saturate((value - minValue_) * rcpRange);
+                slab[2 * i]     = static_cast<uint16_t>(t * 65535 + 0.5f);
+                slab[2 * i + 1] = 65535;
+            }
+        });
+
+        glTexSubImage3D(
+            GL_TEXTURE_3D, 0, 0, 0, zBeg, res.x, res.y, zEnd - zBeg,
+            GL_RG, GL_UNSIGNED_SHORT, slab.data());
+    }
+
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+float VolumeRenderer::getPixelToWorldScale() const noexcept
+{
+    return distance_ * 2
+         * std::tan(agz::math::deg2rad(PERSPECTIVE_FOV_DEG) / 2) / height();
+}
+
+void VolumeRenderer::mousePressEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::RightButton)
+    {
+        lastRightPressX_ = event->x();
+        lastRightPressY_ = event->y();
+        rightPressed_ = true;
+    }
+    else if(event->button() == Qt::MiddleButton)
+    {
+        lastMiddlePressX_ = event->x();
+        lastMiddlePressY_ = event->y();
+        middlePressed_ = true;
+    }
+}
+
+void VolumeRenderer::mouseReleaseEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::RightButton)
+        rightPressed_ = false;
+    else if(event->button() == Qt::MiddleButton)
+        middlePressed_ = false;
+}
+
+void VolumeRenderer::mouseMoveEvent(QMouseEvent *event)
+{
+    if(rightPressed_)
+    {
+        constexpr float PI = agz::math::PI_f;
+
+        const int dx = event->x() - lastRightPressX_;
+        const int dy = event->y() - lastRightPressY_;
+        lastRightPressX_ = event->x();
+        lastRightPressY_ = event->y();
+
+        vertRad_ = agz::math::clamp(
+            vertRad_ - 0.003f * dy, -PI / 2 + 0.01f, PI / 2 - 0.01f);
+        horiRad_ -= 0.003f * dx;
+
+        update();
+    }
+    else if(middlePressed_)
+    {
+        const int dx = event->x() - lastMiddlePressX_;
+        const int dy = event->y() - lastMiddlePressY_;
+        lastMiddlePressX_ = event->x();
+        lastMiddlePressY_ = event->y();
+
+        const float pixelToWorldScale = getPixelToWorldScale();
+
+        const Vec3 dir = {
+            std::cos(vertRad_) * std::cos(horiRad_),
+            std::sin(vertRad_),
+            std::cos(vertRad_) * std::sin(horiRad_)
+        };
+        const Vec3 ex = cross(dir, Vec3(0, 1, 0)).normalize();
+        const Vec3 ey = cross(ex, dir);
+
+        lookAt_ += dx * pixelToWorldScale * ex + dy * pixelToWorldScale * ey;
+
+        update();
+    }
+}
+
+void VolumeRenderer::leaveEvent(QEvent *event)
+{
+    rightPressed_ = false;
+    middlePressed_ = false;
+}
+
+void VolumeRenderer::wheelEvent(QWheelEvent *event)
+{
+    const int dZ = event->angleDelta().y();
+
+    if(dZ > 0)
+    {
+        for(int i = 0; i < dZ; i += 120)
+            distance_ *= 0.90909f;
+    }
+    else
+    {
+        for(int i = 0; i > dZ; i -= 120)
+            distance_ *= 1.1f;
+    }
+
+    const AABB &bbox = grid_->getBoundingBox();
+    distance_ = (std::max)(distance_, 0.05f * distance(bbox.lower, bbox.upper));
+
+    update();
+}